@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdint.h>
 #include <stdbool.h>
 #include <avr/io.h>
+#include <util/twi.h>
 #include "wait.h"
 #include "action_layer.h"
 #include "print.h"
@@ -63,9 +64,28 @@ static matrix_row_t read_cols(uint8_t row);
 static void init_cols(void);
 static void unselect_rows(void);
 static void select_row(uint8_t row);
+static bool read_left_rows(matrix_row_t *rows);
 
 static uint8_t mcp23018_reset_loop;
 
+/*
+ * Scans with I2C errors before the left half counts as disconnected and
+ * its keys are released. Until then the last rows read are kept and the
+ * mcp23018 is set up again on every scan, so a single NACK goes unnoticed.
+ */
+#ifndef MCP23018_ERROR_LIMIT
+#   define MCP23018_ERROR_LIMIT 5
+#endif
+static uint8_t mcp23018_errors;
+// all left half rows selected, as read_left_rows() leaves them
+static bool mcp23018_rows_selected;
+
+#define LEFT_ROWS 7
+/* GPIOB pins with keys on them */
+#define MCP23018_COLS_MASK 0x3F
+/* GPIOA value with all rows selected, A7 isn't a row */
+#define MCP23018_ALL_ROWS (0xFF & ~0x7F)
+
 #ifdef DEBUG_MATRIX_SCAN_RATE
 uint32_t matrix_timer;
 uint32_t matrix_scan_count;
@@ -127,6 +147,7 @@ void matrix_init(void)
 
 void matrix_power_up(void) {
     mcp23018_status = init_mcp23018();
+    mcp23018_rows_selected = false;
 
     unselect_rows();
     init_cols();
@@ -147,7 +168,9 @@ void matrix_power_up(void) {
 uint8_t matrix_scan(void)
 {
     if (mcp23018_status) { // if there was an error
-        if (++mcp23018_reset_loop == 0) {
+        if (mcp23018_errors < MCP23018_ERROR_LIMIT) {
+            mcp23018_status = init_mcp23018();
+        } else if (++mcp23018_reset_loop == 0) {
             // since mcp23018_reset_loop is 8 bit - we'll try to reset once in 255 matrix scans
             // this will be approx bit more frequent than once per second
             print("trying to reset mcp23018\n");
@@ -175,10 +198,32 @@ uint8_t matrix_scan(void)
     }
 #endif
 
+    matrix_row_t left_rows[LEFT_ROWS];
+    bool left_read = read_left_rows(left_rows);
+    if (left_read) {
+        mcp23018_errors = 0;
+    } else if (mcp23018_errors < MCP23018_ERROR_LIMIT && ++mcp23018_errors == MCP23018_ERROR_LIMIT) {
+        print("left side not responding\n");
+        for (uint8_t i = 0; i < LEFT_ROWS; i++) {
+            left_rows[i] = 0;
+        }
+        left_read = true;
+    }
+
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-        select_row(i);
-        wait_us(30);  // without this wait read unstable value.
-        matrix_row_t cols = read_cols(i);
+        matrix_row_t cols;
+        if (i < LEFT_ROWS) {
+            if (!left_read) {
+                // keep the last rows while the mcp23018 recovers
+                continue;
+            }
+            cols = left_rows[i];
+        } else {
+            select_row(i);
+            wait_us(30);  // without this wait read unstable value.
+            cols = read_cols(i);
+            unselect_rows();
+        }
         if (matrix_debouncing[i] != cols) {
             matrix_debouncing[i] = cols;
             if (debouncing) {
@@ -186,7 +231,6 @@ uint8_t matrix_scan(void)
             }
             debouncing = DEBOUNCE;
         }
-        unselect_rows();
     }
 
     if (debouncing) {
@@ -263,32 +307,106 @@ static void  init_cols(void)
     PORTF |=  (1<<7 | 1<<6 | 1<<5 | 1<<4 | 1<<1 | 1<<0);
 }
 
-static matrix_row_t read_cols(uint8_t row)
+/*
+ * Selects the left half rows set to 0 in gpioa. Writing GPIOA moves the
+ * mcp23018 register pointer on to GPIOB, so the columns can then be read
+ * without setting the pointer again.
+ */
+static uint8_t mcp23018_select_rows(uint8_t gpioa)
 {
-    if (row < 7) {
-        if (mcp23018_status) { // if there was an error
-            return 0;
-        } else {
-            uint8_t data = 0;
-            mcp23018_status = i2c_start(I2C_ADDR_WRITE);    if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write(GPIOB);             if (mcp23018_status) goto out;
-            mcp23018_status = i2c_start(I2C_ADDR_READ);     if (mcp23018_status) goto out;
-            data = i2c_readNak();
-            data = ~data;
-        out:
-            i2c_stop();
-            return data;
+    mcp23018_status = i2c_start(I2C_ADDR_WRITE);    if (mcp23018_status) goto out;
+    mcp23018_status = i2c_write(GPIOA);             if (mcp23018_status) goto out;
+    mcp23018_status = i2c_write(gpioa);             if (mcp23018_status) goto out;
+out:
+    i2c_stop();
+    return mcp23018_status;
+}
+
+// Reads GPIOB, the register pointer has to point to it already
+static uint8_t mcp23018_read_cols(matrix_row_t *cols)
+{
+    uint8_t data;
+    mcp23018_status = i2c_start(I2C_ADDR_READ);     if (mcp23018_status) goto out;
+    data = i2c_readNak();
+    if ((TW_STATUS & 0xF8) != TW_MR_DATA_NACK) {
+        mcp23018_status = 1;
+        goto out;
+    }
+    *cols = ~data & MCP23018_COLS_MASK;
+out:
+    i2c_stop();
+    return mcp23018_status;
+}
+
+/*
+ * The left half rows stay selected between scans, so one read of the
+ * columns shows whether any key there is down. Only then are the rows
+ * scanned one by one, a select and a two byte read each.
+ *
+ * Returns false if the mcp23018 didn't answer, rows is left unchanged.
+ */
+static bool read_left_rows(matrix_row_t *rows)
+{
+    if (mcp23018_status) {
+        return false;
+    }
+
+    if (!mcp23018_rows_selected) {
+        // after a reset or an interrupted scan
+        if (mcp23018_select_rows(MCP23018_ALL_ROWS)) {
+            return false;
+        }
+        mcp23018_rows_selected = true;
+        wait_us(30);
+    }
+
+    matrix_row_t any = 0;
+    mcp23018_status = i2c_start(I2C_ADDR_WRITE);    if (mcp23018_status) goto out;
+    mcp23018_status = i2c_write(GPIOB);             if (mcp23018_status) goto out;
+    if (mcp23018_read_cols(&any)) {
+        return false;
+    }
+    if (!any) {
+        for (uint8_t i = 0; i < LEFT_ROWS; i++) {
+            rows[i] = 0;
+        }
+        return true;
+    }
+
+    matrix_row_t scanned[LEFT_ROWS];
+    mcp23018_rows_selected = false;
+    for (uint8_t i = 0; i < LEFT_ROWS; i++) {
+        if (mcp23018_select_rows(0xFF & ~(1<<i))) {
+            return false;
+        }
+        wait_us(30);  // without this wait read unstable value.
+        if (mcp23018_read_cols(&scanned[i])) {
+            return false;
         }
-    } else {
-        // read from teensy
-        return
-            (PINF&(1<<0) ? 0 : (1<<0)) |
-            (PINF&(1<<1) ? 0 : (1<<1)) |
-            (PINF&(1<<4) ? 0 : (1<<2)) |
-            (PINF&(1<<5) ? 0 : (1<<3)) |
-            (PINF&(1<<6) ? 0 : (1<<4)) |
-            (PINF&(1<<7) ? 0 : (1<<5)) ;
     }
+    if (mcp23018_select_rows(MCP23018_ALL_ROWS)) {
+        return false;
+    }
+    mcp23018_rows_selected = true;
+    for (uint8_t i = 0; i < LEFT_ROWS; i++) {
+        rows[i] = scanned[i];
+    }
+    return true;
+out:
+    i2c_stop();
+    return false;
+}
+
+static matrix_row_t read_cols(uint8_t row)
+{
+    // read from teensy, the mcp23018 columns are read in read_left_rows()
+    return
+        (PINF&(1<<0) ? 0 : (1<<0)) |
+        (PINF&(1<<1) ? 0 : (1<<1)) |
+        (PINF&(1<<4) ? 0 : (1<<2)) |
+        (PINF&(1<<5) ? 0 : (1<<3)) |
+        (PINF&(1<<6) ? 0 : (1<<4)) |
+        (PINF&(1<<7) ? 0 : (1<<5)) ;
 }
 
 /* Row pin configuration
@@ -303,19 +421,7 @@ static matrix_row_t read_cols(uint8_t row)
  */
 static void unselect_rows(void)
 {
-    // unselect on mcp23018
-    if (mcp23018_status) { // if there was an error
-        // do nothing
-    } else {
-        // set all rows hi-Z : 1
-        mcp23018_status = i2c_start(I2C_ADDR_WRITE);    if (mcp23018_status) goto out;
-        mcp23018_status = i2c_write(GPIOA);             if (mcp23018_status) goto out;
-        mcp23018_status = i2c_write( 0xFF
-                              & ~(0<<7)
-                          );                            if (mcp23018_status) goto out;
-    out:
-        i2c_stop();
-    }
+    // the mcp23018 rows stay selected for read_left_rows()
 
     // unselect on teensy
     // Hi-Z(DDR:0, PORT:0) to unselect
@@ -329,54 +435,37 @@ static void unselect_rows(void)
 
 static void select_row(uint8_t row)
 {
-    if (row < 7) {
-        // select on mcp23018
-        if (mcp23018_status) { // if there was an error
-            // do nothing
-        } else {
-            // set active row low  : 0
-            // set other rows hi-Z : 1
-            mcp23018_status = i2c_start(I2C_ADDR_WRITE);        if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write(GPIOA);                 if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write( 0xFF & ~(1<<row)
-                                  & ~(0<<7)
-                              );                                if (mcp23018_status) goto out;
-        out:
-            i2c_stop();
-        }
-    } else {
-        // select on teensy
-        // Output low(DDR:1, PORT:0) to select
-        switch (row) {
-            case 7:
-                DDRB  |= (1<<0);
-                PORTB &= ~(1<<0);
-                break;
-            case 8:
-                DDRB  |= (1<<1);
-                PORTB &= ~(1<<1);
-                break;
-            case 9:
-                DDRB  |= (1<<2);
-                PORTB &= ~(1<<2);
-                break;
-            case 10:
-                DDRB  |= (1<<3);
-                PORTB &= ~(1<<3);
-                break;
-            case 11:
-                DDRD  |= (1<<2);
-                PORTD &= ~(1<<3);
-                break;
-            case 12:
-                DDRD  |= (1<<3);
-                PORTD &= ~(1<<3);
-                break;
-            case 13:
-                DDRC  |= (1<<6);
-                PORTC &= ~(1<<6);
-                break;
-        }
+    // select on teensy, the mcp23018 rows are done in read_left_rows()
+    // Output low(DDR:1, PORT:0) to select
+    switch (row) {
+        case 7:
+            DDRB  |= (1<<0);
+            PORTB &= ~(1<<0);
+            break;
+        case 8:
+            DDRB  |= (1<<1);
+            PORTB &= ~(1<<1);
+            break;
+        case 9:
+            DDRB  |= (1<<2);
+            PORTB &= ~(1<<2);
+            break;
+        case 10:
+            DDRB  |= (1<<3);
+            PORTB &= ~(1<<3);
+            break;
+        case 11:
+            DDRD  |= (1<<2);
+            PORTD &= ~(1<<3);
+            break;
+        case 12:
+            DDRD  |= (1<<3);
+            PORTD &= ~(1<<3);
+            break;
+        case 13:
+            DDRC  |= (1<<6);
+            PORTC &= ~(1<<6);
+            break;
     }
 }
 
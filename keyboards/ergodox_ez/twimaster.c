@@ -20,6 +20,31 @@
 /* I2C clock in Hz */
 #define SCL_CLOCK  400000L
 
+/* Limits the time we wait for any one step of a transfer, so that a slave
+ * that hangs or a disconnected cable can't hang the keyboard. A byte takes
+ * 9 bit times and the poll loop at least 8 clock cycles, allow for twice
+ * that.
+ */
+#define I2C_LOOP_TIMEOUT (2*9*(F_CPU/SCL_CLOCK)/8)
+
+
+/* Waits for the TWI to finish the current step.
+ * Return: 0 done, 1 timed out, the TWI is reset and releases the bus
+ */
+static unsigned char i2c_wait(void)
+{
+	uint16_t lim = 0;
+	while(!(TWCR & (1<<TWINT)))
+	{
+		if (++lim > I2C_LOOP_TIMEOUT)
+		{
+			TWCR = 0;
+			return 1;
+		}
+	}
+	return 0;
+}
+
 
 /*************************************************************************
  Initialization of the I2C bus interface. Need to be called only once
@@ -52,7 +77,7 @@ unsigned char i2c_start(unsigned char address)
 	TWCR = (1<<TWINT) | (1<<TWSTA) | (1<<TWEN);
 
 	// wait until transmission completed
-	while(!(TWCR & (1<<TWINT)));
+	if (i2c_wait()) return 1;
 
 	// check value of TWI Status Register. Mask prescaler bits.
 	twst = TW_STATUS & 0xF8;
@@ -63,7 +88,7 @@ unsigned char i2c_start(unsigned char address)
 	TWCR = (1<<TWINT) | (1<<TWEN);
 
 	// wail until transmission completed and ACK/NACK has been received
-	while(!(TWCR & (1<<TWINT)));
+	if (i2c_wait()) return 1;
 
 	// check value of TWI Status Register. Mask prescaler bits.
 	twst = TW_STATUS & 0xF8;
@@ -147,7 +172,8 @@ void i2c_stop(void)
 	TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWSTO);
 	
 	// wait until stop condition is executed and bus released
-	while(TWCR & (1<<TWSTO));
+	uint16_t lim = 0;
+	while((TWCR & (1<<TWSTO)) && ++lim <= I2C_LOOP_TIMEOUT);
 
 }/* i2c_stop */
 
@@ -168,7 +194,7 @@ unsigned char i2c_write( unsigned char data )
 	TWCR = (1<<TWINT) | (1<<TWEN);
 
 	// wait until transmission completed
-	while(!(TWCR & (1<<TWINT)));
+	if (i2c_wait()) return 1;
 
 	// check value of TWI Status Register. Mask prescaler bits
 	twst = TW_STATUS & 0xF8;
@@ -186,7 +212,7 @@ unsigned char i2c_write( unsigned char data )
 unsigned char i2c_readAck(void)
 {
 	TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWEA);
-	while(!(TWCR & (1<<TWINT)));    
+	i2c_wait();
 
     return TWDR;
 
@@ -201,7 +227,7 @@ unsigned char i2c_readAck(void)
 unsigned char i2c_readNak(void)
 {
 	TWCR = (1<<TWINT) | (1<<TWEN);
-	while(!(TWCR & (1<<TWINT)));
+	i2c_wait();
 	
     return TWDR;
 
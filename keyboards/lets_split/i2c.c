@@ -3,12 +3,13 @@
 #include <stdlib.h>
 #include <avr/interrupt.h>
 #include <util/twi.h>
+#include <util/delay.h>
 #include <stdbool.h>
 #include "i2c.h"
 
 // Limits the amount of we wait for any one i2c transaction.
-// Since were running SCL line 100kHz (=> 10μs/bit), and each transactions is
-// 9 bits, a single transaction will take around 90μs to complete.
+// Since were running SCL line 400kHz (=> 2.5μs/bit), and each transactions is
+// 9 bits, a single transaction will take around 23μs to complete.
 //
 // (F_CPU/SCL_CLOCK)  =>  # of μC cycles to transfer a bit
 // poll loop takes at least 8 clock cycles to execute
@@ -32,7 +33,7 @@ void i2c_delay(void) {
   // _delay_us(100);
 }
 
-// Setup twi to run at 100kHz
+// Setup twi to run at 400kHz
 void i2c_master_init(void) {
   // no prescaler
   TWSR = 0;
@@ -98,8 +99,24 @@ uint8_t i2c_master_read(int ack) {
   return TWDR;
 }
 
+// TWI pins
+#define I2C_SCL _BV(PD0)
+#define I2C_SDA _BV(PD1)
+
+// Releases the bus after an error. A slave that was reset in the middle of
+// sending a byte holds SDA low until it gets the rest of its clock pulses,
+// at most 9 of them.
 void i2c_reset_state(void) {
   TWCR = 0;
+
+  PORTD &= ~(I2C_SCL | I2C_SDA);
+  DDRD &= ~(I2C_SCL | I2C_SDA);
+  for (uint8_t i = 0; i < 9 && !(PIND & I2C_SDA); ++i) {
+    DDRD |= I2C_SCL;
+    _delay_us(5);
+    DDRD &= ~I2C_SCL;
+    _delay_us(5);
+  }
 }
 
 void i2c_slave_init(uint8_t address) {
@@ -149,6 +166,13 @@ ISR(TWI_vect) {
       BUFFER_POS_INC();
       break;
 
+    case TW_ST_DATA_NACK:
+    case TW_ST_LAST_DATA:
+      // the master is done reading, reads without setting the location
+      // first start at 0 again
+      slave_buffer_pos = 0;
+      break;
+
     case TW_BUS_ERROR: // something went wrong, reset twi state
       TWCR = 0;
     default:
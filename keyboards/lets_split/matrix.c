@@ -145,47 +145,83 @@ uint8_t _matrix_scan(void)
     return 1;
 }
 
+/*
+ * Slave buffer layout for i2c. The slave bumps the sequence number
+ * whenever its rows change, writing I2C_SEQ_BEGIN first and I2C_SEQ_END
+ * last. The master only polls I2C_SEQ_END, and when that changed reads
+ * everything in one burst, which holds a consistent copy of the rows when
+ * both sequence numbers match.
+ */
+#define I2C_SEQ_END    0x00
+#define I2C_ROWS_START 0x01
+#define I2C_SEQ_BEGIN  (I2C_ROWS_START + MATRIX_ROWS/2)
+
+static uint8_t i2c_seq;
+static bool i2c_rows_valid = false;
+
 // Get rows from other half over i2c
 int i2c_transaction(void) {
     int slaveOffset = (isLeftHand) ? (ROWS_PER_HAND) : 0;
+    uint8_t buffer[I2C_SEQ_BEGIN + 1];
+    uint8_t seq;
+    int i;
 
-    int err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_WRITE);
+    // The slave starts reads that don't set a location at 0, so the
+    // sequence number is a two byte transaction
+    int err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_READ);
     if (err) goto i2c_error;
+    seq = i2c_master_read(I2C_NACK);
+    i2c_master_stop();
+
+    if (i2c_rows_valid && seq == i2c_seq) {
+        return 0;
+    }
 
-    // start of matrix stored at 0x00
-    err = i2c_master_write(0x00);
+    err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_WRITE);
+    if (err) goto i2c_error;
+
+    err = i2c_master_write(I2C_SEQ_END);
     if (err) goto i2c_error;
 
     // Start read
     err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_READ);
     if (err) goto i2c_error;
 
-    if (!err) {
-        int i;
-        for (i = 0; i < ROWS_PER_HAND-1; ++i) {
-            matrix[slaveOffset+i] = i2c_master_read(I2C_ACK);
-        }
-        matrix[slaveOffset+i] = i2c_master_read(I2C_NACK);
-        i2c_master_stop();
-    } else {
-i2c_error: // the cable is disconnceted, or something else went wrong
-        i2c_reset_state();
-        return err;
+    for (i = 0; i < I2C_SEQ_BEGIN; ++i) {
+        buffer[i] = i2c_master_read(I2C_ACK);
     }
+    buffer[i] = i2c_master_read(I2C_NACK);
+    i2c_master_stop();
 
+    // the slave was writing its rows, they'll be read on the next scan
+    if (buffer[I2C_SEQ_END] == buffer[I2C_SEQ_BEGIN]) {
+        for (i = 0; i < ROWS_PER_HAND; ++i) {
+            matrix[slaveOffset+i] = buffer[I2C_ROWS_START+i];
+        }
+        i2c_seq = buffer[I2C_SEQ_END];
+        i2c_rows_valid = true;
+    }
     return 0;
+
+i2c_error: // the cable is disconnceted, or something else went wrong
+    i2c_reset_state();
+    // the slave may have been reset, read everything next time
+    i2c_rows_valid = false;
+    return err;
 }
 
 #ifndef USE_I2C
 int serial_transaction(void) {
     int slaveOffset = (isLeftHand) ? (ROWS_PER_HAND) : 0;
 
-    if (serial_update_buffers()) {
-        return 1;
+    int err = serial_update_buffers();
+    if (err) {
+        return err;
     }
 
+    const volatile uint8_t *slave_buffer = serial_slave_front_buffer();
     for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        matrix[slaveOffset+i] = serial_slave_buffer[i];
+        matrix[slaveOffset+i] = slave_buffer[i];
     }
     return 0;
 }
@@ -198,10 +234,15 @@ uint8_t matrix_scan(void)
 
 
 #ifdef USE_I2C
-    if( i2c_transaction() ) {
+    int err = i2c_transaction();
 #else
-    if( serial_transaction() ) {
+    int err = serial_transaction();
+    if (err == SERIAL_BUSY) {
+        // the exchange with the other half runs in the background, keep
+        // its rows until it finishes
+    } else
 #endif
+    if( err ) {
         // turn on the indicator led when halves are disconnected
         TXLED1;
 
@@ -231,14 +272,24 @@ void matrix_slave_scan(void) {
     int offset = (isLeftHand) ? 0 : (MATRIX_ROWS / 2);
 
 #ifdef USE_I2C
+    bool changed = false;
     for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        /* i2c_slave_buffer[i] = matrix[offset+i]; */
-        i2c_slave_buffer[i] = matrix[offset+i];
+        changed |= i2c_slave_buffer[I2C_ROWS_START+i] != matrix[offset+i];
+    }
+    if (changed) {
+        uint8_t seq = i2c_slave_buffer[I2C_SEQ_BEGIN] + 1;
+        i2c_slave_buffer[I2C_SEQ_BEGIN] = seq;
+        for (int i = 0; i < ROWS_PER_HAND; ++i) {
+            i2c_slave_buffer[I2C_ROWS_START+i] = matrix[offset+i];
+        }
+        i2c_slave_buffer[I2C_SEQ_END] = seq;
     }
 #else
+    volatile uint8_t *slave_buffer = serial_slave_back_buffer();
     for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        serial_slave_buffer[i] = matrix[offset+i];
+        slave_buffer[i] = matrix[offset+i];
     }
+    serial_slave_buffer_swap();
 #endif
 }
 
@@ -268,6 +319,13 @@ void matrix_print(void)
         pbin_reverse16(matrix_get_row(row));
         print("\n");
     }
+#ifndef USE_I2C
+    print("serial transfers: "); print_dec(serial_counters.transfers);
+    print(" checksum: "); print_dec(serial_counters.checksum_errors);
+    print(" framing: "); print_dec(serial_counters.framing_errors);
+    print(" timeouts: "); print_dec(serial_counters.timeouts);
+    print("\n");
+#endif
 }
 
 uint8_t matrix_key_count(void)
@@ -1,5 +1,16 @@
 /*
- * WARNING: be careful changing this code, it is very timing dependent
+ * Interrupt driven one wire serial between the halves.
+ *
+ * Both halves use the same pin. Bytes are sent like on a UART, a low start
+ * bit, 8 data bits LSB first and a high stop bit, and are timed by the
+ * timer 1 compare interrupt. The receiver finds the start bit with INT0
+ * and samples the middle of each bit, so the clocks only have to agree
+ * for the length of one byte.
+ *
+ * The master starts an exchange by sending the master buffer and a
+ * checksum, and releases the line. The slave checks it and answers with
+ * its front buffer and a checksum. Nothing blocks, the master finds the
+ * result on the next call to serial_update_buffers().
  */
 
 #ifndef F_CPU
@@ -8,25 +19,69 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
-#include <util/delay.h>
 #include <stdbool.h>
 
 #include "serial.h"
 
-// Serial pulse period in microseconds. Its probably a bad idea to lower this
-// value.
-#define SERIAL_DELAY 24
+#ifndef USE_I2C
+
+#if defined(BACKLIGHT_BREATHING) || defined(SLEEP_LED_ENABLE) || \
+    (defined(BACKLIGHT_ENABLE) && defined(BACKLIGHT_PIN))
+#error "the serial link uses timer 1, which the backlight PWM and the sleep LED need too"
+#endif
+
+#define BIT_TICKS (F_CPU / SERIAL_BAUD)
+
+// The bits the receiver waits for the next start bit before giving up
+#define TIMEOUT_BITS 10
+
+// The bits the slave waits before answering, so that the master has
+// released the line
+#define TURNAROUND_BITS 1
+
+#if SERIAL_SLAVE_BUFFER_LENGTH > SERIAL_MASTER_BUFFER_LENGTH
+#define MAX_FRAME_SIZE (SERIAL_SLAVE_BUFFER_LENGTH + 1)
+#else
+#define MAX_FRAME_SIZE (SERIAL_MASTER_BUFFER_LENGTH + 1)
+#endif
+
+// After a failure both halves wait for the line to stay high this many
+// bits, longer than inside a frame, so that they don't take a data bit
+// for a start bit. The master waits longer, for the slave to time out
+// and wait in turn.
+#define SLAVE_GUARD_BITS (TIMEOUT_BITS + 1)
+#define MASTER_GUARD_BITS (TIMEOUT_BITS + 1 + SLAVE_GUARD_BITS + 2)
 
-uint8_t volatile serial_slave_buffer[SERIAL_SLAVE_BUFFER_LENGTH] = {0};
 uint8_t volatile serial_master_buffer[SERIAL_MASTER_BUFFER_LENGTH] = {0};
+static uint8_t volatile slave_buffers[2][SERIAL_SLAVE_BUFFER_LENGTH] = {{0}};
+static uint8_t volatile slave_front = 0;
+
+volatile serial_counters_t serial_counters;
 
 #define SLAVE_DATA_CORRUPT (1<<0)
 volatile uint8_t status = 0;
 
-inline static
-void serial_delay(void) {
-  _delay_us(SERIAL_DELAY);
-}
+enum {
+  STATE_IDLE,
+  STATE_SEND,
+  // Waiting for the start bit of the next byte
+  STATE_RECV_WAIT,
+  STATE_RECV,
+  // Waiting for the line to go quiet after a failure
+  STATE_GUARD,
+};
+
+static volatile uint8_t state = STATE_IDLE;
+static volatile int8_t transfer_result = SERIAL_BUSY;
+static bool is_master;
+
+static uint8_t frame[MAX_FRAME_SIZE];
+static uint8_t frame_size;
+static uint8_t frame_pos;
+// 0 is the start bit, 1 to 8 the data and 9 the stop bit
+static uint8_t bit;
+static uint8_t shift;
+static uint8_t wait_ticks;
 
 inline static
 void serial_output(void) {
@@ -55,171 +110,301 @@ void serial_high(void) {
   SERIAL_PIN_PORT |= SERIAL_PIN_MASK;
 }
 
+inline static
+void timer_start(void) {
+  TCNT1 = 0;
+  TIFR1 = _BV(OCF1A);
+  TIMSK1 |= _BV(OCIE1A);
+}
+
+inline static
+void timer_stop(void) {
+  TIMSK1 &= ~_BV(OCIE1A);
+}
+
+// Listen for the falling edge of the next start bit
+inline static
+void start_bit_enable(void) {
+  EIFR = _BV(INTF0);
+  EIMSK |= _BV(INT0);
+}
+
+inline static
+void start_bit_disable(void) {
+  EIMSK &= ~_BV(INT0);
+}
+
+static
+void timer_init(void) {
+  // CTC mode without prescaler, one compare interrupt per bit
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS10);
+  OCR1A = BIT_TICKS - 1;
+  // Trigger on falling edge of INT0
+  EICRA = (EICRA & ~_BV(ISC00)) | _BV(ISC01);
+}
+
+volatile uint8_t* serial_slave_back_buffer(void) {
+  return slave_buffers[slave_front ^ 1];
+}
+
+void serial_slave_buffer_swap(void) {
+  slave_front ^= 1;
+}
+
+const volatile uint8_t* serial_slave_front_buffer(void) {
+  return slave_buffers[slave_front];
+}
+
 void serial_master_init(void) {
+  is_master = true;
+  timer_init();
   serial_output();
   serial_high();
 }
 
 void serial_slave_init(void) {
+  is_master = false;
+  timer_init();
   serial_input();
+  start_bit_enable();
+}
 
-  // Enable INT0
-  EIMSK |= _BV(INT0);
-  // Trigger on falling edge of INT0
-  EICRA &= ~(_BV(ISC00) | _BV(ISC01));
+static
+void go_idle(void) {
+  timer_stop();
+  state = STATE_IDLE;
+  if (is_master) {
+    // always, release the line when not in use
+    serial_output();
+    serial_high();
+  } else {
+    serial_input();
+    start_bit_enable();
+  }
 }
 
-// Used by the master to synchronize timing with the slave.
 static
-void sync_recv(void) {
+void transfer_failed(volatile uint16_t* counter) {
+  (*counter)++;
+  start_bit_disable();
+  if (is_master) {
+    transfer_result = 1;
+  }
+  // The other half may still be sending
   serial_input();
-  // This shouldn't hang if the slave disconnects because the
-  // serial line will float to high if the slave does disconnect.
-  while (!serial_read_pin());
-  serial_delay();
+  wait_ticks = 0;
+  state = STATE_GUARD;
 }
 
-// Used by the slave to send a synchronization signal to the master.
 static
-void sync_send(void) {
-  serial_output();
-
-  serial_low();
-  serial_delay();
+uint8_t checksum(const volatile uint8_t* data, uint8_t size) {
+  uint8_t sum = 0;
+  for (uint8_t i = 0; i < size; ++i) {
+    sum += data[i];
+  }
+  return sum;
+}
 
+// Starts sending the frame, the first tick drives the start bit
+static
+void begin_send(uint8_t wait) {
+  frame_pos = 0;
+  bit = 0;
+  wait_ticks = wait;
+  serial_output();
   serial_high();
+  state = STATE_SEND;
 }
 
-// Reads a byte from the serial line
 static
-uint8_t serial_read_byte(void) {
-  uint8_t byte = 0;
+void begin_recv(uint8_t size) {
+  frame_size = size;
+  frame_pos = 0;
+  wait_ticks = 0;
+  state = STATE_RECV_WAIT;
   serial_input();
-  for ( uint8_t i = 0; i < 8; ++i) {
-    byte = (byte << 1) | serial_read_pin();
-    serial_delay();
-    _delay_us(1);
+  start_bit_enable();
+}
+
+static
+void send_done(void) {
+  if (is_master) {
+    begin_recv(SERIAL_SLAVE_BUFFER_LENGTH + 1);
+  } else {
+    go_idle();
   }
+}
 
-  return byte;
+static
+void recv_done(void) {
+  uint8_t size = frame_size - 1;
+  if (checksum(frame, size) != frame[size]) {
+    if (!is_master) {
+      status |= SLAVE_DATA_CORRUPT;
+    }
+    // The slave doesn't answer, the master times out
+    transfer_failed(&serial_counters.checksum_errors);
+    return;
+  }
+  serial_counters.transfers++;
+
+  if (is_master) {
+    volatile uint8_t* buffer = slave_buffers[slave_front ^ 1];
+    for (uint8_t i = 0; i < SERIAL_SLAVE_BUFFER_LENGTH; ++i) {
+      buffer[i] = frame[i];
+    }
+    slave_front ^= 1;
+    transfer_result = 0;
+    go_idle();
+  } else {
+    status &= ~SLAVE_DATA_CORRUPT;
+    for (uint8_t i = 0; i < SERIAL_MASTER_BUFFER_LENGTH; ++i) {
+      serial_master_buffer[i] = frame[i];
+    }
+    // The main loop only ever writes the back buffer
+    const volatile uint8_t* buffer = slave_buffers[slave_front];
+    for (uint8_t i = 0; i < SERIAL_SLAVE_BUFFER_LENGTH; ++i) {
+      frame[i] = buffer[i];
+    }
+    frame[SERIAL_SLAVE_BUFFER_LENGTH] = checksum(frame, SERIAL_SLAVE_BUFFER_LENGTH);
+    frame_size = SERIAL_SLAVE_BUFFER_LENGTH + 1;
+    begin_send(TURNAROUND_BITS);
+  }
 }
 
-// Sends a byte with MSB ordering
 static
-void serial_write_byte(uint8_t data) {
-  uint8_t b = 8;
-  serial_output();
-  while( b-- ) {
-    if(data & (1 << b)) {
+void send_tick(void) {
+  if (wait_ticks) {
+    wait_ticks--;
+    return;
+  }
+  if (bit == 0) {
+    if (frame_pos == frame_size) {
+      // The stop bit of the last byte has been sent
+      send_done();
+      return;
+    }
+    serial_low();
+    shift = frame[frame_pos];
+  } else if (bit <= 8) {
+    if (shift & 1) {
       serial_high();
     } else {
       serial_low();
     }
-    serial_delay();
+    shift >>= 1;
+  } else {
+    serial_high();
+  }
+  if (++bit == 10) {
+    bit = 0;
+    frame_pos++;
   }
 }
 
-// interrupt handle to be used by the slave device
-ISR(SERIAL_PIN_INTERRUPT) {
-  sync_send();
-
-  uint8_t checksum = 0;
-  for (int i = 0; i < SERIAL_SLAVE_BUFFER_LENGTH; ++i) {
-    serial_write_byte(serial_slave_buffer[i]);
-    sync_send();
-    checksum += serial_slave_buffer[i];
+static
+void recv_tick(void) {
+  uint8_t level = serial_read_pin();
+  if (bit == 0) {
+    if (level) {
+      transfer_failed(&serial_counters.framing_errors);
+      return;
+    }
+  } else if (bit <= 8) {
+    shift >>= 1;
+    if (level) {
+      shift |= 0x80;
+    }
+  } else {
+    if (!level) {
+      transfer_failed(&serial_counters.framing_errors);
+      return;
+    }
+    frame[frame_pos++] = shift;
+    if (frame_pos == frame_size) {
+      recv_done();
+    } else {
+      wait_ticks = 0;
+      state = STATE_RECV_WAIT;
+      start_bit_enable();
+    }
+    return;
   }
-  serial_write_byte(checksum);
-  sync_send();
-
-  // wait for the sync to finish sending
-  serial_delay();
-
-  // read the middle of pulses
-  _delay_us(SERIAL_DELAY/2);
+  bit++;
+}
 
-  uint8_t checksum_computed = 0;
-  for (int i = 0; i < SERIAL_MASTER_BUFFER_LENGTH; ++i) {
-    serial_master_buffer[i] = serial_read_byte();
-    sync_send();
-    checksum_computed += serial_master_buffer[i];
+// Start bit of a byte from the other half
+ISR(SERIAL_PIN_INTERRUPT) {
+  // The next compare match is half a bit from now, in the middle of the
+  // start bit
+  TCNT1 = BIT_TICKS / 2;
+  TIFR1 = _BV(OCF1A);
+  TIMSK1 |= _BV(OCIE1A);
+  start_bit_disable();
+  if (state == STATE_IDLE) {
+    // A request from the master
+    frame_size = SERIAL_MASTER_BUFFER_LENGTH + 1;
+    frame_pos = 0;
   }
-  uint8_t checksum_received = serial_read_byte();
-  sync_send();
-
-  serial_input(); // end transaction
+  bit = 0;
+  state = STATE_RECV;
+}
 
-  if ( checksum_computed != checksum_received ) {
-    status |= SLAVE_DATA_CORRUPT;
-  } else {
-    status &= ~SLAVE_DATA_CORRUPT;
+ISR(TIMER1_COMPA_vect) {
+  switch (state) {
+    case STATE_SEND:
+      send_tick();
+      break;
+    case STATE_RECV:
+      recv_tick();
+      break;
+    case STATE_RECV_WAIT:
+      if (++wait_ticks > TIMEOUT_BITS) {
+        transfer_failed(&serial_counters.timeouts);
+      }
+      break;
+    case STATE_GUARD:
+      if (!serial_read_pin()) {
+        wait_ticks = 0;
+      } else if (++wait_ticks > (is_master ? MASTER_GUARD_BITS : SLAVE_GUARD_BITS)) {
+        go_idle();
+      }
+      break;
+    default:
+      timer_stop();
+      break;
   }
 }
 
-inline
-bool serial_slave_DATA_CORRUPT(void) {
+bool serial_slave_data_corrupt(void) {
   return status & SLAVE_DATA_CORRUPT;
 }
 
-// Copies the serial_slave_buffer to the master and sends the
-// serial_master_buffer to the slave.
+// Collects the result of the last exchange and starts the next one, the
+// slave buffer and serial_master_buffer are exchanged in the background.
 //
 // Returns:
-// 0 => no error
-// 1 => slave did not respond
+// 0 => the last exchange succeeded, the slave front buffer holds its data
+// 1 => the last exchange failed
+// SERIAL_BUSY => no exchange finished since the last call
 int serial_update_buffers(void) {
-  // this code is very time dependent, so we need to disable interrupts
   cli();
+  int8_t result = transfer_result;
+  transfer_result = SERIAL_BUSY;
+  sei();
 
-  // signal to the slave that we want to start a transaction
-  serial_output();
-  serial_low();
-  _delay_us(1);
-
-  // wait for the slaves response
-  serial_input();
-  serial_high();
-  _delay_us(SERIAL_DELAY);
-
-  // check if the slave is present
-  if (serial_read_pin()) {
-    // slave failed to pull the line low, assume not present
-    sei();
-    return 1;
-  }
-
-  // if the slave is present syncronize with it
-  sync_recv();
-
-  uint8_t checksum_computed = 0;
-  // receive data from the slave
-  for (int i = 0; i < SERIAL_SLAVE_BUFFER_LENGTH; ++i) {
-    serial_slave_buffer[i] = serial_read_byte();
-    sync_recv();
-    checksum_computed += serial_slave_buffer[i];
-  }
-  uint8_t checksum_received = serial_read_byte();
-  sync_recv();
-
-  if (checksum_computed != checksum_received) {
-    sei();
-    return 1;
-  }
-
-  uint8_t checksum = 0;
-  // send data to the slave
-  for (int i = 0; i < SERIAL_MASTER_BUFFER_LENGTH; ++i) {
-    serial_write_byte(serial_master_buffer[i]);
-    sync_recv();
-    checksum += serial_master_buffer[i];
+  if (state == STATE_IDLE) {
+    for (uint8_t i = 0; i < SERIAL_MASTER_BUFFER_LENGTH; ++i) {
+      frame[i] = serial_master_buffer[i];
+    }
+    frame[SERIAL_MASTER_BUFFER_LENGTH] = checksum(frame, SERIAL_MASTER_BUFFER_LENGTH);
+    frame_size = SERIAL_MASTER_BUFFER_LENGTH + 1;
+    // Keep the line high for a bit before the first start bit
+    begin_send(0);
+    timer_start();
   }
-  serial_write_byte(checksum);
-  sync_recv();
-
-  // always, release the line when not in use
-  serial_output();
-  serial_high();
-
-  sei();
-  return 0;
+  return result;
 }
+
+#endif
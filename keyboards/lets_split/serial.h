@@ -3,6 +3,7 @@
 
 #include "config.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 /* TODO:  some defines for interrupt setup */
 #define SERIAL_PIN_DDR DDRD
@@ -14,10 +15,40 @@
 #define SERIAL_SLAVE_BUFFER_LENGTH MATRIX_ROWS/2
 #define SERIAL_MASTER_BUFFER_LENGTH 1
 
-// Buffers for master - slave communication
-extern volatile uint8_t serial_slave_buffer[SERIAL_SLAVE_BUFFER_LENGTH];
+// Bits per second on the wire. Each byte is sent as a start bit, 8 data
+// bits and a stop bit, so an exchange of the matrix takes about 2 ms at
+// the default rate. Lower it if the transfer counters show errors.
+#ifndef SERIAL_BAUD
+#define SERIAL_BAUD 40000
+#endif
+
+// serial_update_buffers() result while a transfer is still running
+#define SERIAL_BUSY -1
+
+// Buffer for master - slave communication, the master writes it and the
+// slave reads it
 extern volatile uint8_t serial_master_buffer[SERIAL_MASTER_BUFFER_LENGTH];
 
+// The slave buffer is double buffered, so that neither side sees half of
+// a transfer. The slave fills the back buffer and publishes it with
+// serial_slave_buffer_swap(). On the master the front buffer holds the
+// last slave buffer that was received intact.
+volatile uint8_t* serial_slave_back_buffer(void);
+void serial_slave_buffer_swap(void);
+const volatile uint8_t* serial_slave_front_buffer(void);
+
+// Transfer counters, they wrap around
+typedef struct {
+    uint16_t transfers;
+    uint16_t checksum_errors;
+    // A start bit that was too short or a missing stop bit
+    uint16_t framing_errors;
+    // The other half stopped sending, or didn't answer
+    uint16_t timeouts;
+} serial_counters_t;
+
+extern volatile serial_counters_t serial_counters;
+
 void serial_master_init(void);
 void serial_slave_init(void);
 int serial_update_buffers(void);
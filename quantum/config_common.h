@@ -4,6 +4,10 @@
 /* diode directions */
 #define COL2ROW 0
 #define ROW2COL 1
+/* debounce algorithms */
+#define DEBOUNCE_DEFER_GLOBAL 0
+#define DEBOUNCE_DEFER_PK 1
+#define DEBOUNCE_EAGER_PK 2
 /* I/O pins */
 #define B0 0x30
 #define B1 0x31
@@ -0,0 +1,175 @@
+/*
+Copyright 2016 Jack Humbert
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "debug.h"
+#include "debounce.h"
+
+/*
+ * DEBOUNCE_DEFER_GLOBAL: any change restarts one shared countdown, the
+ *     whole matrix is taken over when it expires (classic tmk behaviour).
+ * DEBOUNCE_DEFER_PK: each key has its own countdown, started when the
+ *     scanned state differs from the reported one. The key is taken over
+ *     when it expires, a bounce back cancels it.
+ * DEBOUNCE_EAGER_PK: a press is reported on the first edge and the key is
+ *     then locked for DEBOUNCING_DELAY; a release is deferred like above.
+ */
+
+static uint16_t debounce_time;
+static bool debounce_started = false;
+
+/* milliseconds since the previous call, saturated to fit a counter */
+static uint8_t debounce_elapsed(void)
+{
+    uint16_t now = timer_read();
+    uint16_t elapsed = debounce_started ? TIMER_DIFF_16(now, debounce_time) : 0;
+    debounce_time = now;
+    debounce_started = true;
+    return elapsed > UINT8_MAX ? UINT8_MAX : elapsed;
+}
+
+#if DEBOUNCING_DELAY == 0
+
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, uint8_t num_cols, bool changed)
+{
+    if (!changed) return false;
+    for (uint8_t i = 0; i < num_rows; i++) {
+        cooked[i] = raw[i];
+    }
+    return true;
+}
+
+bool debounce_active(void)
+{
+    return false;
+}
+
+#elif DEBOUNCE_ALGORITHM == DEBOUNCE_DEFER_GLOBAL
+
+static uint8_t debouncing = 0;
+
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, uint8_t num_cols, bool changed)
+{
+    uint8_t elapsed = debounce_elapsed();
+
+    if (changed) {
+        if (debouncing) {
+            debug("bounce!: "); debug_hex(debouncing); debug("\n");
+        }
+        debouncing = DEBOUNCING_DELAY;
+        return false;
+    }
+    if (!debouncing) return false;
+    if (debouncing > elapsed) {
+        debouncing -= elapsed;
+        return false;
+    }
+    debouncing = 0;
+    for (uint8_t i = 0; i < num_rows; i++) {
+        cooked[i] = raw[i];
+    }
+    return true;
+}
+
+bool debounce_active(void)
+{
+    return debouncing;
+}
+
+#elif DEBOUNCE_ALGORITHM == DEBOUNCE_DEFER_PK || DEBOUNCE_ALGORITHM == DEBOUNCE_EAGER_PK
+
+/* remaining milliseconds per key, 0 when idle */
+static uint8_t debounce_counters[MATRIX_ROWS * MATRIX_COLS];
+static uint16_t debounce_pending = 0;
+
+#define COUNTER_MASK 0x7F
+/* eager: a release is waiting for the countdown, as opposed to a lockout */
+#define COUNTER_RELEASE 0x80
+
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, uint8_t num_cols, bool changed)
+{
+    uint8_t elapsed = debounce_elapsed();
+    bool cooked_changed = false;
+
+    if (!changed && !debounce_pending) return false;
+
+    uint8_t *counter = debounce_counters;
+    for (uint8_t i = 0; i < num_rows; i++) {
+        matrix_row_t delta = raw[i] ^ cooked[i];
+        for (uint8_t j = 0; j < num_cols; j++, counter++) {
+            matrix_row_t mask = (matrix_row_t)1 << j;
+            if (*counter) {
+                if ((*counter & COUNTER_MASK) > elapsed) {
+                    *counter -= elapsed;
+#if DEBOUNCE_ALGORITHM == DEBOUNCE_DEFER_PK
+                    if (!(delta & mask)) {
+                        // bounced back before the countdown ran out
+                        *counter = 0;
+                        debounce_pending--;
+                    }
+#else
+                    if (!(delta & mask) && (*counter & COUNTER_RELEASE)) {
+                        *counter = 0;
+                        debounce_pending--;
+                    }
+#endif
+                    continue;
+                }
+#if DEBOUNCE_ALGORITHM == DEBOUNCE_DEFER_PK
+                if (delta & mask) {
+                    cooked[i] ^= mask;
+                    delta ^= mask;
+                    cooked_changed = true;
+                }
+#else
+                if ((*counter & COUNTER_RELEASE) && (delta & mask)) {
+                    cooked[i] &= ~mask;
+                    delta ^= mask;
+                    cooked_changed = true;
+                }
+#endif
+                *counter = 0;
+                debounce_pending--;
+            }
+            if (!(delta & mask)) continue;
+#if DEBOUNCE_ALGORITHM == DEBOUNCE_EAGER_PK
+            if (raw[i] & mask) {
+                // report the press now and ignore chatter for a while
+                cooked[i] |= mask;
+                cooked_changed = true;
+                *counter = DEBOUNCING_DELAY;
+            } else {
+                *counter = DEBOUNCING_DELAY | COUNTER_RELEASE;
+            }
+#else
+            *counter = DEBOUNCING_DELAY;
+#endif
+            debounce_pending++;
+        }
+    }
+    return cooked_changed;
+}
+
+bool debounce_active(void)
+{
+    return debounce_pending;
+}
+
+#else
+#   error "DEBOUNCE_ALGORITHM: invalid value"
+#endif
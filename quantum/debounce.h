@@ -0,0 +1,35 @@
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config_common.h"
+#include "matrix.h"
+
+/* Set 0 if debouncing isn't needed */
+#ifndef DEBOUNCING_DELAY
+#   define DEBOUNCING_DELAY 5
+#endif
+
+/* debounce algorithms, see config_common.h */
+#ifndef DEBOUNCE_ALGORITHM
+#   define DEBOUNCE_ALGORITHM DEBOUNCE_DEFER_PK
+#endif
+
+#if DEBOUNCING_DELAY > 127
+#   error "DEBOUNCING_DELAY must be less than 128"
+#endif
+
+/* Filter freshly scanned rows in raw into cooked.
+ * num_rows and num_cols describe the layout of raw, which is the scan
+ * orientation (columns and rows are swapped for ROW2COL).
+ * changed tells whether raw differs from the previous scan.
+ * Returns true when cooked was modified.
+ * Never blocks: timing comes from timer_read() deltas between calls.
+ */
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, uint8_t num_cols, bool changed);
+
+/* true while some key is still waiting for its debounce time */
+bool debounce_active(void);
+
+#endif
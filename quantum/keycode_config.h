@@ -1,3 +1,6 @@
+#ifndef KEYCODE_CONFIG_H
+#define KEYCODE_CONFIG_H
+
 #include "eeconfig.h"
 #include "keycode.h"
 
@@ -19,3 +22,5 @@ typedef union {
 } keymap_config_t;
 
 extern keymap_config_t keymap_config;
+
+#endif
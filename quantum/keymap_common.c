@@ -37,107 +37,177 @@ extern keymap_config_t keymap_config;
 
 #include <inttypes.h>
 
+/* Decoders for keycode ranges. The keycode high byte selects one through
+ * page_decoders[], basic keycodes are split further by their low byte
+ * through basic_decoders[], so every keycode costs at most two table
+ * reads and one dense switch.
+ */
+enum keycode_decoder {
+    DECODE_NONE = 0,
+    DECODE_BASIC,
+    DECODE_KEY,
+    DECODE_SYSTEM,
+    DECODE_CONSUMER,
+    DECODE_MOUSE,
+    DECODE_FN,
+    DECODE_TRNS,
+    DECODE_MODS,
+    DECODE_FUNCTION,
+    DECODE_MACRO,
+    DECODE_LAYER_TAP,
+    DECODE_TO,
+    DECODE_MOMENTARY,
+    DECODE_DEF_LAYER,
+    DECODE_TOGGLE_LAYER,
+    DECODE_ONE_SHOT_LAYER,
+    DECODE_ONE_SHOT_MOD,
+    DECODE_MOD_TAP,
+    DECODE_QUANTUM,
+};
+
+/* keycodes from 0x8000 up have no action */
+static const uint8_t PROGMEM page_decoders[0x80] = {
+    [QK_TMK >> 8]                                       = DECODE_BASIC,
+    [QK_MODS >> 8 ... QK_MODS_MAX >> 8]                 = DECODE_MODS,
+    [QK_FUNCTION >> 8 ... QK_FUNCTION_MAX >> 8]         = DECODE_FUNCTION,
+    [QK_MACRO >> 8 ... QK_MACRO_MAX >> 8]               = DECODE_MACRO,
+    [QK_LAYER_TAP >> 8 ... QK_LAYER_TAP_MAX >> 8]       = DECODE_LAYER_TAP,
+    [QK_TO >> 8]                                        = DECODE_TO,
+    [QK_MOMENTARY >> 8]                                 = DECODE_MOMENTARY,
+    [QK_DEF_LAYER >> 8]                                 = DECODE_DEF_LAYER,
+    [QK_TOGGLE_LAYER >> 8]                              = DECODE_TOGGLE_LAYER,
+    [QK_ONE_SHOT_LAYER >> 8]                            = DECODE_ONE_SHOT_LAYER,
+    [QK_ONE_SHOT_MOD >> 8]                              = DECODE_ONE_SHOT_MOD,
+    [QK_MOD_TAP >> 8 ... QK_MOD_TAP_MAX >> 8]           = DECODE_MOD_TAP,
+    [RESET >> 8]                                        = DECODE_QUANTUM,
+};
+
+static const uint8_t PROGMEM basic_decoders[0x100] = {
+    [KC_TRNS]                                           = DECODE_TRNS,
+    [KC_A ... KC_EXSEL]                                 = DECODE_KEY,
+    [KC_LCTRL ... KC_RGUI]                              = DECODE_KEY,
+    [KC_SYSTEM_POWER ... KC_SYSTEM_WAKE]                = DECODE_SYSTEM,
+    [KC_AUDIO_MUTE ... KC_MEDIA_REWIND]                 = DECODE_CONSUMER,
+    [KC_MS_UP ... KC_MS_ACCEL2]                         = DECODE_MOUSE,
+    [KC_FN0 ... KC_FN31]                                = DECODE_FN,
+};
+
 /* converts key to action */
 action_t action_for_key(uint8_t layer, keypos_t key)
 {
     // 16bit keycodes - important
-    uint16_t keycode = keymap_key_to_keycode(layer, key);
-
-    // keycode remapping
-    keycode = keycode_config(keycode);
+    return action_for_keycode(keymap_key_to_keycode(layer, key));
+}
 
+/* converts keycode to action */
+action_t action_for_keycode(uint16_t keycode)
+{
     action_t action;
     uint8_t action_layer, when, mod;
-    // The arm-none-eabi compiler generates out of bounds warnings when using the fn_actions directly for some reason
-    const uint16_t* actions = fn_actions;
 
-    switch (keycode) {
-        case KC_FN0 ... KC_FN31:
-            action.code = pgm_read_word(&actions[FN_INDEX(keycode)]);
+    uint8_t decoder = DECODE_NONE;
+    if ((keycode >> 8) < sizeof(page_decoders)) {
+        decoder = pgm_read_byte(&page_decoders[keycode >> 8]);
+    }
+    if (decoder == DECODE_BASIC) {
+        // keycode remapping, only basic keycodes are affected
+        keycode = keycode_config(keycode);
+        decoder = pgm_read_byte(&basic_decoders[keycode & 0xFF]);
+    }
+
+    switch (decoder) {
+        case DECODE_FN:
+            action.code = pgm_read_word(&fn_actions[FN_INDEX(keycode)]);
             break;
-        case KC_A ... KC_EXSEL:
-        case KC_LCTRL ... KC_RGUI:
+        case DECODE_KEY:
             action.code = ACTION_KEY(keycode);
             break;
-        case KC_SYSTEM_POWER ... KC_SYSTEM_WAKE:
+        case DECODE_SYSTEM:
             action.code = ACTION_USAGE_SYSTEM(KEYCODE2SYSTEM(keycode));
             break;
-        case KC_AUDIO_MUTE ... KC_MEDIA_REWIND:
+        case DECODE_CONSUMER:
             action.code = ACTION_USAGE_CONSUMER(KEYCODE2CONSUMER(keycode));
             break;
-        case KC_MS_UP ... KC_MS_ACCEL2:
+        case DECODE_MOUSE:
             action.code = ACTION_MOUSEKEY(keycode);
             break;
-        case KC_TRNS:
+        case DECODE_TRNS:
             action.code = ACTION_TRANSPARENT;
             break;
-        case QK_MODS ... QK_MODS_MAX: ;
+        case DECODE_MODS:
             // Has a modifier
             // Split it up
             action.code = ACTION_MODS_KEY(keycode >> 8, keycode & 0xFF); // adds modifier to key
             break;
-        case QK_FUNCTION ... QK_FUNCTION_MAX: ;
+        case DECODE_FUNCTION:
             // Is a shortcut for function action_layer, pull last 12bits
             // This means we have 4,096 FN macros at our disposal
-            action.code = pgm_read_word(&actions[(int)keycode & 0xFFF]);
+            action.code = pgm_read_word(&fn_actions[(int)keycode & 0xFFF]);
             break;
-        case QK_MACRO ... QK_MACRO_MAX:
+        case DECODE_MACRO:
             action.code = ACTION_MACRO(keycode & 0xFF);
             break;
-        case QK_LAYER_TAP ... QK_LAYER_TAP_MAX:
+        case DECODE_LAYER_TAP:
             action.code = ACTION_LAYER_TAP_KEY((keycode >> 0x8) & 0xF, keycode & 0xFF);
             break;
-        case QK_TO ... QK_TO_MAX: ;
+        case DECODE_TO:
             // Layer set "GOTO"
             when = (keycode >> 0x4) & 0x3;
             action_layer = keycode & 0xF;
             action.code = ACTION_LAYER_SET(action_layer, when);
             break;
-        case QK_MOMENTARY ... QK_MOMENTARY_MAX: ;
+        case DECODE_MOMENTARY:
             // Momentary action_layer
             action_layer = keycode & 0xFF;
             action.code = ACTION_LAYER_MOMENTARY(action_layer);
             break;
-        case QK_DEF_LAYER ... QK_DEF_LAYER_MAX: ;
+        case DECODE_DEF_LAYER:
             // Set default action_layer
             action_layer = keycode & 0xFF;
             action.code = ACTION_DEFAULT_LAYER_SET(action_layer);
             break;
-        case QK_TOGGLE_LAYER ... QK_TOGGLE_LAYER_MAX: ;
+        case DECODE_TOGGLE_LAYER:
             // Set toggle
             action_layer = keycode & 0xFF;
             action.code = ACTION_LAYER_TOGGLE(action_layer);
             break;
-        case QK_ONE_SHOT_LAYER ... QK_ONE_SHOT_LAYER_MAX: ;
+        case DECODE_ONE_SHOT_LAYER:
             // OSL(action_layer) - One-shot action_layer
             action_layer = keycode & 0xFF;
             action.code = ACTION_LAYER_ONESHOT(action_layer);
             break;
-        case QK_ONE_SHOT_MOD ... QK_ONE_SHOT_MOD_MAX: ;
+        case DECODE_ONE_SHOT_MOD:
             // OSM(mod) - One-shot mod
             mod = keycode & 0xFF;
             action.code = ACTION_MODS_ONESHOT(mod);
             break;
-        case QK_MOD_TAP ... QK_MOD_TAP_MAX:
+        case DECODE_MOD_TAP:
             action.code = ACTION_MODS_TAP_KEY((keycode >> 0x8) & 0xF, keycode & 0xFF);
             break;
-    #ifdef BACKLIGHT_ENABLE
-        case BL_0 ... BL_15:
-            action.code = ACTION_BACKLIGHT_LEVEL(keycode - BL_0);
-            break;
-        case BL_DEC:
-            action.code = ACTION_BACKLIGHT_DECREASE();
-            break;
-        case BL_INC:
-            action.code = ACTION_BACKLIGHT_INCREASE();
-            break;
-        case BL_TOGG:
-            action.code = ACTION_BACKLIGHT_TOGGLE();
+        case DECODE_QUANTUM:
+            switch (keycode) {
+            #ifdef BACKLIGHT_ENABLE
+                case BL_0 ... BL_15:
+                    action.code = ACTION_BACKLIGHT_LEVEL(keycode - BL_0);
+                    break;
+                case BL_DEC:
+                    action.code = ACTION_BACKLIGHT_DECREASE();
+                    break;
+                case BL_INC:
+                    action.code = ACTION_BACKLIGHT_INCREASE();
+                    break;
+                case BL_TOGG:
+                    action.code = ACTION_BACKLIGHT_TOGGLE();
+                    break;
+                case BL_STEP:
+                    action.code = ACTION_BACKLIGHT_STEP();
+                    break;
+            #endif
+                default:
+                    action.code = ACTION_NO;
+                    break;
+            }
             break;
-        case BL_STEP:
-            action.code = ACTION_BACKLIGHT_STEP();
-            break;
-    #endif
         default:
             action.code = ACTION_NO;
             break;
@@ -145,11 +215,6 @@ action_t action_for_key(uint8_t layer, keypos_t key)
     return action;
 }
 
-__attribute__ ((weak))
-const uint16_t PROGMEM fn_actions[] = {
-
-};
-
 /* Macro */
 __attribute__ ((weak))
 const macro_t *action_get_macro(keyrecord_t *record, uint8_t id, uint8_t opt)
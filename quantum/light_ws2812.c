@@ -15,6 +15,27 @@
 #include <avr/io.h>
 #include <util/delay.h>
 #include "debug.h"
+#include "timer.h"
+
+// The LEDs latch once the line has been low for the reset time. Rather than
+// waiting for that after every frame, the next frame waits if it may come
+// too early. The timer counts whole milliseconds, so that is a frame within
+// 2 ms of the last one.
+static uint16_t last_frame = 0;
+static uint8_t sent_frame = 0;
+
+static void ws2812_wait_reset(uint8_t reset_us)
+{
+  if (sent_frame && timer_elapsed(last_frame) < 2) {
+    _delay_us(reset_us);
+  }
+}
+
+static void ws2812_frame_sent(void)
+{
+  last_frame = timer_read();
+  sent_frame = 1;
+}
 
 // Setleds for standard RGB
 void inline ws2812_setleds(struct cRGB *ledarray, uint16_t leds)
@@ -29,8 +50,9 @@ void inline ws2812_setleds_pin(struct cRGB *ledarray, uint16_t leds, uint8_t pin
   // new universal format (DDR)
   _SFR_IO8((RGB_DI_PIN >> 4) + 1) |= pinmask;
 
+  ws2812_wait_reset(50);
   ws2812_sendarray_mask((uint8_t*)ledarray,leds+leds+leds,pinmask);
-  _delay_us(50);
+  ws2812_frame_sent();
 }
 
 // Setleds for SK6812RGBW
@@ -40,8 +62,9 @@ void inline ws2812_setleds_rgbw(struct cRGBW *ledarray, uint16_t leds)
   // new universal format (DDR)
   _SFR_IO8((RGB_DI_PIN >> 4) + 1) |= _BV(RGB_DI_PIN & 0xF);
 
+  ws2812_wait_reset(80);
   ws2812_sendarray_mask((uint8_t*)ledarray,leds<<2,_BV(RGB_DI_PIN & 0xF));
-  _delay_us(80);
+  ws2812_frame_sent();
 }
 
 void ws2812_sendarray(uint8_t *data,uint16_t datlen)
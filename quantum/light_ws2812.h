@@ -39,7 +39,8 @@ struct cRGBW { uint8_t g; uint8_t r; uint8_t b; uint8_t w;};
  * The functions will perform the following actions:
  *         - Set the data-out pin as output
  *         - Send out the LED data
- *         - Wait 50�s to reset the LEDs
+ *         - Return without waiting 50us for the LEDs to latch, the next
+ *           call waits instead if it comes within 2ms
  */
 
 void ws2812_setleds     (struct cRGB  *ledarray, uint16_t number_of_leds);
@@ -17,7 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdint.h>
 #include <stdbool.h>
-#if defined(__AVR__)
+#if defined(__AVR__) || defined(PROTOCOL_HOST_SIM)
 #include <avr/io.h>
 #endif
 #include "wait.h"
@@ -25,13 +25,67 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "util.h"
 #include "matrix.h"
+#include "debounce.h"
+#include "matrix_ports.h"
+#include "timer.h"
+#ifdef PROTOCOL_HOST_SIM
+#include "sim.h"
+#endif
+
+/* Time for a selected row to settle before its columns are read. This wait
+ * is most of the scan time, boards with short traces and strong pull-ups
+ * can lower it.
+ */
+#ifndef MATRIX_IO_DELAY
+#   define MATRIX_IO_DELAY 30
+#endif
+
+/* A row settles while the one before it is compared, and the first row
+ * while the keys of the last scan are debounced and processed, so
+ * settle_wait() only waits for what is left of MATRIX_IO_DELAY. The AVR
+ * times it on timer 0, which counts the milliseconds of timer.c, in
+ * TIMER_RAW ticks of 4 us at 16 MHz. One tick is added, since the first
+ * one may be partly gone when the row is selected.
+ */
+#if defined(__AVR__)
+#   define SETTLE_TICKS (MATRIX_IO_DELAY ? (MATRIX_IO_DELAY * (TIMER_RAW_FREQ / 1000) + 999) / 1000 + 1 : 0)
+#   if SETTLE_TICKS > TIMER_RAW_TOP
+#       error "MATRIX_IO_DELAY must be shorter than a millisecond"
+#   endif
+static uint8_t settle_start;
+
+static inline void settle_begin(void)
+{
+    settle_start = TIMER_RAW;
+}
 
-/* Set 0 if debouncing isn't needed */
+static void settle_wait(void)
+{
+    uint8_t now;
+    do {
+        now = TIMER_RAW;
+        /* TIMER_RAW counts from 0 to TIMER_RAW_TOP */
+    } while (TIMER_DIFF(now, settle_start, TIMER_RAW_TOP + 1) < SETTLE_TICKS);
+}
+#elif defined(PROTOCOL_HOST_SIM)
+static uint32_t settle_start;
+
+static inline void settle_begin(void)
+{
+    settle_start = sim_clock_us();
+}
 
-#ifndef DEBOUNCING_DELAY
-#   define DEBOUNCING_DELAY 5
+static void settle_wait(void)
+{
+    uint32_t elapsed = sim_clock_us() - settle_start;
+    if (elapsed < MATRIX_IO_DELAY) {
+        wait_us(MATRIX_IO_DELAY - elapsed);
+    }
+}
+#else
+static inline void settle_begin(void) {}
+static inline void settle_wait(void) { wait_us(MATRIX_IO_DELAY); }
 #endif
-static uint8_t debouncing = DEBOUNCING_DELAY;
 
 static const uint8_t row_pins[MATRIX_ROWS] = MATRIX_ROW_PINS;
 static const uint8_t col_pins[MATRIX_COLS] = MATRIX_COL_PINS;
@@ -45,16 +99,27 @@ static matrix_row_t matrix_debouncing[MATRIX_ROWS];
     static matrix_row_t matrix_reversed_debouncing[MATRIX_COLS];
 #endif
 
-#if MATRIX_COLS > 16
-    #define SHIFTER 1UL
+/* read_cols() reads every port once per row, the pins are grouped by port
+ * when building, see matrix_ports.awk
+ */
+#if DIODE_DIRECTION == COL2ROW
+#   if MATRIX_READ_PORTS_PIN_COUNT != MATRIX_COLS
+#       error "matrix_ports.h doesn't match MATRIX_COL_PINS, rebuild it"
+#   endif
 #else
-    #define SHIFTER 1
+#   if MATRIX_READ_PORTS_PIN_COUNT != MATRIX_ROWS
+#       error "matrix_ports.h doesn't match MATRIX_ROW_PINS, rebuild it"
+#   endif
 #endif
 
 static matrix_row_t read_cols(void);
 static void init_cols(void);
 static void unselect_rows(void);
+static void unselect_row(uint8_t row);
 static void select_row(uint8_t row);
+#if DIODE_DIRECTION == ROW2COL
+static void matrix_transpose(void);
+#endif
 
 __attribute__ ((weak))
 void matrix_init_quantum(void) {
@@ -128,6 +193,9 @@ void matrix_init(void) {
     // initialize row and col
     unselect_rows();
     init_cols();
+    // the first row is kept selected between scans
+    select_row(0);
+    settle_begin();
 
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) {
@@ -140,61 +208,41 @@ void matrix_init(void) {
 
 uint8_t matrix_scan(void)
 {
+    bool changed = false;
 
 #if DIODE_DIRECTION == COL2ROW
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-        select_row(i);
-        wait_us(30);  // without this wait read unstable value.
+        settle_wait();  // without this wait read unstable value.
         matrix_row_t cols = read_cols();
+        unselect_row(i);
+        // the next row settles while this one is compared, the first one
+        // until the next scan
+        select_row(i + 1 < MATRIX_ROWS ? i + 1 : 0);
+        settle_begin();
         if (matrix_debouncing[i] != cols) {
             matrix_debouncing[i] = cols;
-            if (debouncing) {
-                debug("bounce!: "); debug_hex(debouncing); debug("\n");
-            }
-            debouncing = DEBOUNCING_DELAY;
+            changed = true;
         }
-        unselect_rows();
     }
 
-    if (debouncing) {
-        if (--debouncing) {
-            wait_ms(1);
-        } else {
-            for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-                matrix[i] = matrix_debouncing[i];
-            }
-        }
-    }
+    debounce(matrix_debouncing, matrix, MATRIX_ROWS, MATRIX_COLS, changed);
 #else
     for (uint8_t i = 0; i < MATRIX_COLS; i++) {
-        select_row(i);
-        wait_us(30);  // without this wait read unstable value.
+        settle_wait();  // without this wait read unstable value.
         matrix_row_t rows = read_cols();
+        unselect_row(i);
+        // the next column settles while this one is compared, the first
+        // one until the next scan
+        select_row(i + 1 < MATRIX_COLS ? i + 1 : 0);
+        settle_begin();
         if (matrix_reversed_debouncing[i] != rows) {
             matrix_reversed_debouncing[i] = rows;
-            if (debouncing) {
-                debug("bounce!: "); debug_hex(debouncing); debug("\n");
-            }
-            debouncing = DEBOUNCING_DELAY;
+            changed = true;
         }
-        unselect_rows();
     }
 
-    if (debouncing) {
-        if (--debouncing) {
-            wait_ms(1);
-        } else {
-            for (uint8_t i = 0; i < MATRIX_COLS; i++) {
-                matrix_reversed[i] = matrix_reversed_debouncing[i];
-            }
-        }
-    }
-    for (uint8_t y = 0; y < MATRIX_ROWS; y++) {
-        matrix_row_t row = 0;
-        for (uint8_t x = 0; x < MATRIX_COLS; x++) {
-            row |= ((matrix_reversed[x] & (1<<y)) >> y) << x;
-        }
-        matrix[y] = row;
+    if (debounce(matrix_reversed_debouncing, matrix_reversed, MATRIX_COLS, MATRIX_ROWS, changed)) {
+        matrix_transpose();
     }
 #endif
 
@@ -205,7 +253,7 @@ uint8_t matrix_scan(void)
 
 bool matrix_is_modified(void)
 {
-    if (debouncing) return false;
+    if (debounce_active()) return false;
     return true;
 }
 
@@ -257,16 +305,7 @@ static void init_cols(void)
 static matrix_row_t read_cols(void)
 {
     matrix_row_t result = 0;
-
-#if DIODE_DIRECTION == COL2ROW
-    for(int x = 0; x < MATRIX_COLS; x++) {     
-        int pin = col_pins[x];
-#else
-    for(int x = 0; x < MATRIX_ROWS; x++) {
-        int pin = row_pins[x];
-#endif
-        result |= (_SFR_IO8(pin >> 4) & _BV(pin & 0xF)) ? 0 : (SHIFTER << x);
-    }
+    MATRIX_READ_PORTS(result, _SFR_IO8);
     return result;
 }
 
@@ -284,6 +323,17 @@ static void unselect_rows(void)
     }
 }
 
+static void unselect_row(uint8_t row)
+{
+#if DIODE_DIRECTION == COL2ROW
+    int pin = row_pins[row];
+#else
+    int pin = col_pins[row];
+#endif
+    _SFR_IO8((pin >> 4) + 1) &= ~_BV(pin & 0xF);
+    _SFR_IO8((pin >> 4) + 2) |= _BV(pin & 0xF);
+}
+
 static void select_row(uint8_t row)
 {
 
@@ -295,3 +345,25 @@ static void select_row(uint8_t row)
     _SFR_IO8((pin >> 4) + 1) |=  _BV(pin & 0xF);
     _SFR_IO8((pin >> 4) + 2) &= ~_BV(pin & 0xF);
 }
+
+#if DIODE_DIRECTION == ROW2COL
+/* rebuild matrix[] from the column-wise matrix_reversed[] */
+static void matrix_transpose(void)
+{
+    matrix_row_t square[sizeof(matrix_row_t) * 8] = { 0 };
+
+    for (uint8_t x = 0; x < MATRIX_COLS; x++) {
+        square[x] = matrix_reversed[x];
+    }
+#if MATRIX_COLS <= 8
+    bittrans(square);
+#elif MATRIX_COLS <= 16
+    bittrans16(square);
+#else
+    bittrans32(square);
+#endif
+    for (uint8_t y = 0; y < MATRIX_ROWS; y++) {
+        matrix[y] = square[y];
+    }
+}
+#endif
@@ -0,0 +1,101 @@
+# Groups the pins quantum/matrix.c reads for a row by port, at build time.
+#
+# Input is preprocessor output with one line
+#
+#     matrix_ports: { 0xF1, 0xF0, 0x30, ... }
+#
+# holding MATRIX_COL_PINS (MATRIX_ROW_PINS for ROW2COL), other lines are
+# ignored. Output is a header with
+#
+#     #define MATRIX_READ_PORTS(result, read_port) ...
+#
+# which reads every port once and ORs its pins into result. Pins of a port
+# with the same offset between pin and result bit share one mask and shift,
+# so pins wired in order cost one shift per port. Switches pull the pins
+# low, a set bit is a closed switch. `-v name=...` changes the macro name.
+
+function fail(message) {
+    print "matrix_ports.awk: " message > "/dev/stderr"
+    failed = 1
+    exit 1
+}
+
+function pin_value(token,   value, i) {
+    if (token ~ /^0[xX][0-9a-fA-F]+$/) {
+        value = 0
+        for (i = 3; i <= length(token); i++) {
+            value = value * 16 + index("0123456789abcdef", tolower(substr(token, i, 1))) - 1
+        }
+        return value
+    }
+    if (token ~ /^[0-9]+$/) {
+        return token + 0
+    }
+    fail("pin '" token "' is not a number, use the pin names of config_common.h")
+}
+
+function hex(value) {
+    return sprintf("0x%02X", value)
+}
+
+BEGIN {
+    if (name == "") name = "MATRIX_READ_PORTS"
+}
+
+/^matrix_ports:/ {
+    list = $0
+    sub(/^matrix_ports:/, "", list)
+    found = 1
+}
+
+END {
+    if (failed) exit 1
+    if (!found) fail("no matrix_ports: line in the input")
+    if (list !~ /^[ \t]*\{.*\}[ \t]*$/) fail("expected a pin list in braces, got '" list "'")
+    gsub(/[{},]/, " ", list)
+    count = split(list, token, " ")
+
+    ports = 0
+    for (bit = 0; bit < count; bit++) {
+        code = pin_value(token[bit + 1])
+        port = int(code / 16)
+        pin = code % 16
+        if (pin > 7) fail("pin " hex(code) " is not on an 8 bit port")
+        if ((port, pin) in used) fail("pin " hex(code) " is listed twice")
+        used[port, pin] = 1
+
+        if (!(port in port_index)) {
+            port_index[port] = ports
+            port_code[ports] = port
+            shifts[ports] = 0
+            ports++
+        }
+        p = port_index[port]
+        shift = bit - pin
+        if (!((p, shift) in mask)) {
+            shift_value[p, shifts[p]++] = shift
+            mask[p, shift] = 0
+        }
+        mask[p, shift] += 2 ^ pin
+    }
+
+    print "/* Generated by quantum/matrix_ports.awk, do not edit */"
+    print "#define " name "_PIN_COUNT " count
+    print "#define " name "(result, read_port) do { \\"
+    print "    uint8_t pins; \\"
+    for (p = 0; p < ports; p++) {
+        print "    pins = ~read_port(" hex(port_code[p]) "); \\"
+        for (s = 0; s < shifts[p]; s++) {
+            shift = shift_value[p, s]
+            bits = "(pins & " hex(mask[p, shift]) ")"
+            if (shift > 0) {
+                print "    result |= (matrix_row_t)" bits " << " shift "; \\"
+            } else if (shift < 0) {
+                print "    result |= " bits " >> " (-shift) "; \\"
+            } else {
+                print "    result |= " bits "; \\"
+            }
+        }
+    }
+    print "} while (0)"
+}
@@ -1,5 +1,13 @@
 #include "quantum.h"
 
+// Kept out of keymap_common.c, where the compiler would take its empty
+// size for the size of the keymap's table and flag every read as out of
+// bounds
+__attribute__ ((weak))
+const uint16_t PROGMEM fn_actions[] = {
+
+};
+
 __attribute__ ((weak))
 bool process_action_kb(keyrecord_t *record) {
   return true;
@@ -41,23 +49,8 @@ static bool shift_interrupted[2] = {0, 0};
 
 bool process_record_quantum(keyrecord_t *record) {
 
-  /* This gets the keycode from the key pressed */
-  keypos_t key = record->event.key;
-  uint16_t keycode;
-
-  #if !defined(NO_ACTION_LAYER) && defined(PREVENT_STUCK_MODIFIERS)
-    uint8_t layer;
-
-    if (record->event.pressed) {
-      layer = layer_switch_get_layer(key);
-      update_source_layers_cache(key, layer);
-    } else {
-      layer = read_source_layers_cache(key);
-    }
-    keycode = keymap_key_to_keycode(layer, key);
-  #else
-    keycode = keymap_key_to_keycode(layer_switch_get_layer(key), key);
-  #endif
+  /* The keycode of the key pressed, resolved once by process_record */
+  uint16_t keycode = record->keycode;
 
     // This is how you use actions here
     // if (keycode == KC_LEAD) {
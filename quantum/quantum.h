@@ -1,7 +1,7 @@
 #ifndef QUANTUM_H
 #define QUANTUM_H
 
-#if defined(__AVR__)
+#if defined(__AVR__) || defined(PROTOCOL_HOST_SIM)
 #include <avr/pgmspace.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
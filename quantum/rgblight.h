@@ -2,8 +2,60 @@
 #define RGBLIGHT_H
 
 
-#if !defined(AUDIO_ENABLE) && defined(RGBLIGHT_TIMER)
-	#define RGBLIGHT_MODES 23
+/* The animations built with RGBLIGHT_TIMER. Set one to 0 in config.h to
+ * leave it out and save its flash, the modes after it move down.
+ *
+ * With audio the flash is usually short, so they are all left out unless
+ * config.h asks for them.
+ */
+#ifdef AUDIO_ENABLE
+#ifndef RGBLIGHT_EFFECT_BREATHING
+#define RGBLIGHT_EFFECT_BREATHING 0
+#endif
+#ifndef RGBLIGHT_EFFECT_RAINBOW_MOOD
+#define RGBLIGHT_EFFECT_RAINBOW_MOOD 0
+#endif
+#ifndef RGBLIGHT_EFFECT_RAINBOW_SWIRL
+#define RGBLIGHT_EFFECT_RAINBOW_SWIRL 0
+#endif
+#ifndef RGBLIGHT_EFFECT_SNAKE
+#define RGBLIGHT_EFFECT_SNAKE 0
+#endif
+#ifndef RGBLIGHT_EFFECT_KNIGHT
+#define RGBLIGHT_EFFECT_KNIGHT 0
+#endif
+#endif
+
+#ifndef RGBLIGHT_EFFECT_BREATHING
+#define RGBLIGHT_EFFECT_BREATHING 1
+#endif
+#ifndef RGBLIGHT_EFFECT_RAINBOW_MOOD
+#define RGBLIGHT_EFFECT_RAINBOW_MOOD 1
+#endif
+#ifndef RGBLIGHT_EFFECT_RAINBOW_SWIRL
+#define RGBLIGHT_EFFECT_RAINBOW_SWIRL 1
+#endif
+#ifndef RGBLIGHT_EFFECT_SNAKE
+#define RGBLIGHT_EFFECT_SNAKE 1
+#endif
+#ifndef RGBLIGHT_EFFECT_KNIGHT
+#define RGBLIGHT_EFFECT_KNIGHT 1
+#endif
+
+// The modes of each effect
+#define RGBLIGHT_BREATHING_VARIANTS 4
+#define RGBLIGHT_RAINBOW_MOOD_VARIANTS 3
+#define RGBLIGHT_RAINBOW_SWIRL_VARIANTS 6
+#define RGBLIGHT_SNAKE_VARIANTS 6
+#define RGBLIGHT_KNIGHT_VARIANTS 3
+
+#ifdef RGBLIGHT_TIMER
+	#define RGBLIGHT_MODES (1 \
+		+ RGBLIGHT_EFFECT_BREATHING * RGBLIGHT_BREATHING_VARIANTS \
+		+ RGBLIGHT_EFFECT_RAINBOW_MOOD * RGBLIGHT_RAINBOW_MOOD_VARIANTS \
+		+ RGBLIGHT_EFFECT_RAINBOW_SWIRL * RGBLIGHT_RAINBOW_SWIRL_VARIANTS \
+		+ RGBLIGHT_EFFECT_SNAKE * RGBLIGHT_SNAKE_VARIANTS \
+		+ RGBLIGHT_EFFECT_KNIGHT * RGBLIGHT_KNIGHT_VARIANTS)
 #else
 	#define RGBLIGHT_MODES 1
 #endif
@@ -33,12 +85,10 @@
 #define RGBLIGHT_VAL_STEP 17
 #endif
 
-#define RGBLED_TIMER_TOP F_CPU/(256*64)
-
 #include <stdint.h>
 #include <stdbool.h>
 #include "eeconfig.h"
-#include "light_ws2812.h"
+#include "rgblight_hsv.h"
 
 typedef union {
   uint32_t raw;
@@ -72,18 +122,21 @@ void eeconfig_update_rgblight(uint32_t val);
 void eeconfig_update_rgblight_default(void);
 void eeconfig_debug_rgblight(void);
 
-void sethsv(uint16_t hue, uint8_t sat, uint8_t val, struct cRGB *led1);
-void setrgb(uint8_t r, uint8_t g, uint8_t b, struct cRGB *led1);
 void rgblight_sethsv_noeeprom(uint16_t hue, uint8_t sat, uint8_t val);
 
-void rgblight_timer_init(void);
+/* With RGBLIGHT_TIMER the animations are drawn by rgblight_task(), which
+ * keyboard_task() calls once per scan. The timer functions switch them on
+ * and off.
+ */
+void rgblight_task(void);
 void rgblight_timer_enable(void);
 void rgblight_timer_disable(void);
 void rgblight_timer_toggle(void);
-void rgblight_effect_breathing(uint8_t interval);
-void rgblight_effect_rainbow_mood(uint8_t interval);
-void rgblight_effect_rainbow_swirl(uint8_t interval);
-void rgblight_effect_snake(uint8_t interval);
-void rgblight_effect_knight(uint8_t interval);
+
+/* Draws the next frame of the current mode's effect and returns the
+ * milliseconds until the one after it, 0 when the mode isn't animated.
+ * The effects are in rgblight_effects.c.
+ */
+uint16_t rgblight_effect_step(void);
 
 #endif
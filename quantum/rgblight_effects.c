@@ -0,0 +1,207 @@
+#include <stddef.h>
+#include "progmem.h"
+#include "rgblight_effects.h"
+
+#ifdef RGBLIGHT_TIMER
+
+static inline void fill(struct cRGB color, struct cRGB *leds) {
+  for (uint8_t i = 0; i < RGBLED_NUM; i++) {
+    leds[i] = color;
+  }
+}
+
+#if RGBLIGHT_EFFECT_BREATHING
+static const uint8_t RGBLED_BREATHING_TABLE[] PROGMEM = {0,0,0,0,1,1,1,2,2,3,4,5,5,6,7,9,10,11,12,14,15,17,18,20,21,23,25,27,29,31,33,35,37,40,42,44,47,49,52,54,57,59,62,65,67,70,73,76,79,82,85,88,90,93,97,100,103,106,109,112,115,118,121,124,127,131,134,137,140,143,146,149,152,155,158,162,165,167,170,173,176,179,182,185,188,190,193,196,198,201,203,206,208,211,213,215,218,220,222,224,226,228,230,232,234,235,237,238,240,241,243,244,245,246,248,249,250,250,251,252,253,253,254,254,254,255,255,255,255,255,255,255,254,254,254,253,253,252,251,250,250,249,248,246,245,244,243,241,240,238,237,235,234,232,230,228,226,224,222,220,218,215,213,211,208,206,203,201,198,196,193,190,188,185,182,179,176,173,170,167,165,162,158,155,152,149,146,143,140,137,134,131,128,124,121,118,115,112,109,106,103,100,97,93,90,88,85,82,79,76,73,70,67,65,62,59,57,54,52,49,47,44,42,40,37,35,33,31,29,27,25,23,21,20,18,17,15,14,12,11,10,9,7,6,5,5,4,3,2,2,1,1,1,0,0,0};
+static const uint8_t RGBLED_BREATHING_INTERVALS[] PROGMEM = {30, 20, 10, 5};
+
+static void breathing_init(rgblight_effect_state_t *state, uint8_t variant) {
+  state->breathing.pos = 0;
+}
+
+static uint16_t breathing_step(rgblight_effect_state_t *state, uint8_t variant,
+                               const rgblight_config_t *config, struct cRGB *leds) {
+  struct cRGB color;
+  sethsv(config->hue, config->sat, pgm_read_byte(&RGBLED_BREATHING_TABLE[state->breathing.pos]), &color);
+  fill(color, leds);
+  state->breathing.pos++;
+  return pgm_read_byte(&RGBLED_BREATHING_INTERVALS[variant]);
+}
+#endif
+
+#if RGBLIGHT_EFFECT_RAINBOW_MOOD
+static const uint8_t RGBLED_RAINBOW_MOOD_INTERVALS[] PROGMEM = {120, 60, 30};
+
+static void rainbow_mood_init(rgblight_effect_state_t *state, uint8_t variant) {
+  state->rainbow_mood.hue = 0;
+}
+
+static uint16_t rainbow_mood_step(rgblight_effect_state_t *state, uint8_t variant,
+                                  const rgblight_config_t *config, struct cRGB *leds) {
+  struct cRGB color;
+  sethsv(state->rainbow_mood.hue, config->sat, config->val, &color);
+  fill(color, leds);
+  if (++state->rainbow_mood.hue == 360) {
+    state->rainbow_mood.hue = 0;
+  }
+  return pgm_read_byte(&RGBLED_RAINBOW_MOOD_INTERVALS[variant]);
+}
+#endif
+
+#if RGBLIGHT_EFFECT_RAINBOW_SWIRL
+static const uint8_t RGBLED_RAINBOW_SWIRL_INTERVALS[] PROGMEM = {100, 50, 20};
+
+static void rainbow_swirl_init(rgblight_effect_state_t *state, uint8_t variant) {
+  state->rainbow_swirl.hue = 0;
+  state->rainbow_swirl.palette.valid = false;
+}
+
+// Odd variants turn the wheel one way, even ones the other
+static uint16_t rainbow_swirl_step(rgblight_effect_state_t *state, uint8_t variant,
+                                   const rgblight_config_t *config, struct cRGB *leds) {
+  uint16_t *hue = &state->rainbow_swirl.hue;
+  hsv_palette_update(&state->rainbow_swirl.palette, config->sat, config->val);
+  hsv_palette_render(&state->rainbow_swirl.palette, *hue, 360/RGBLED_NUM, leds, RGBLED_NUM);
+  if (variant % 2) {
+    *hue = *hue == 359 ? 0 : *hue + 1;
+  } else {
+    *hue = *hue == 0 ? 359 : *hue - 1;
+  }
+  return pgm_read_byte(&RGBLED_RAINBOW_SWIRL_INTERVALS[variant/2]);
+}
+#endif
+
+#if RGBLIGHT_EFFECT_SNAKE
+static const uint8_t RGBLED_SNAKE_INTERVALS[] PROGMEM = {100, 50, 20};
+
+static void snake_init(rgblight_effect_state_t *state, uint8_t variant) {
+  state->snake.pos = 0;
+}
+
+// The head is at pos and the body fades out behind it. Even variants run
+// towards the start of the strip, odd ones towards the end.
+static uint16_t snake_step(rgblight_effect_state_t *state, uint8_t variant,
+                           const rgblight_config_t *config, struct cRGB *leds) {
+  uint8_t pos = state->snake.pos;
+  int8_t direction = variant % 2 ? -1 : 1;
+  fill((struct cRGB){0}, leds);
+  for (uint8_t j = 0; j < RGBLIGHT_EFFECT_SNAKE_LENGTH; j++) {
+    int16_t k = pos + j * direction;
+    if (k < 0) {
+      k += RGBLED_NUM;
+    }
+    if (k >= 0 && k < RGBLED_NUM) {
+      uint8_t val = config->val * (RGBLIGHT_EFFECT_SNAKE_LENGTH - j) / RGBLIGHT_EFFECT_SNAKE_LENGTH;
+      sethsv(config->hue, config->sat, val, &leds[k]);
+    }
+  }
+  if (direction == 1) {
+    state->snake.pos = pos == 0 ? RGBLED_NUM - 1 : pos - 1;
+  } else {
+    state->snake.pos = (pos + 1) % RGBLED_NUM;
+  }
+  return pgm_read_byte(&RGBLED_SNAKE_INTERVALS[variant/2]);
+}
+#endif
+
+#if RGBLIGHT_EFFECT_KNIGHT
+static const uint8_t RGBLED_KNIGHT_INTERVALS[] PROGMEM = {100, 50, 20};
+
+static void knight_init(rgblight_effect_state_t *state, uint8_t variant) {
+  state->knight.pos = 0;
+  state->knight.direction = -1;
+}
+
+// A bar that runs off one end of the strip, turns and runs back. The bar
+// is RGBLIGHT_EFFECT_KNIGHT_LENGTH long and the part off the strip shows
+// on the end LED. The whole picture is shifted by
+// RGBLIGHT_EFFECT_KNIGHT_OFFSET LEDs.
+static uint16_t knight_step(rgblight_effect_state_t *state, uint8_t variant,
+                            const rgblight_config_t *config, struct cRGB *leds) {
+  int8_t pos = state->knight.pos;
+  int8_t direction = state->knight.direction;
+  int16_t low = pos;
+  int16_t high = pos + (RGBLIGHT_EFFECT_KNIGHT_LENGTH - 1) * direction;
+  if (low > high) {
+    int16_t swap = low;
+    low = high;
+    high = swap;
+  }
+  if (low < 0) low = 0;
+  if (low >= RGBLED_NUM) low = RGBLED_NUM - 1;
+  if (high < 0) high = 0;
+  if (high >= RGBLED_NUM) high = RGBLED_NUM - 1;
+
+  struct cRGB color;
+  sethsv(config->hue, config->sat, config->val, &color);
+  for (uint8_t i = 0; i < RGBLED_NUM; i++) {
+    uint8_t cur = (i + RGBLIGHT_EFFECT_KNIGHT_OFFSET) % RGBLED_NUM;
+    if (cur >= low && cur <= high) {
+      leds[i] = color;
+    } else {
+      leds[i] = (struct cRGB){0};
+    }
+  }
+
+  if (direction == 1) {
+    if (pos - 1 < 0 - RGBLIGHT_EFFECT_KNIGHT_LENGTH) {
+      state->knight.pos = 0 - RGBLIGHT_EFFECT_KNIGHT_LENGTH;
+      state->knight.direction = -1;
+    } else {
+      state->knight.pos = pos - 1;
+    }
+  } else {
+    if (pos + 1 > RGBLED_NUM + RGBLIGHT_EFFECT_KNIGHT_LENGTH) {
+      state->knight.pos = RGBLED_NUM + RGBLIGHT_EFFECT_KNIGHT_LENGTH - 1;
+      state->knight.direction = 1;
+    } else {
+      state->knight.pos = pos + 1;
+    }
+  }
+  return pgm_read_byte(&RGBLED_KNIGHT_INTERVALS[variant]);
+}
+#endif
+
+#if RGBLIGHT_MODES > 1
+// In mode order, mode 1 is the static light and the modes of each effect
+// follow the ones of the effect before it
+static const rgblight_effect_t rgblight_effects[] = {
+#if RGBLIGHT_EFFECT_BREATHING
+  {RGBLIGHT_BREATHING_VARIANTS, RGBLIGHT_FLAG_KEEP_VAL, breathing_init, breathing_step},
+#endif
+#if RGBLIGHT_EFFECT_RAINBOW_MOOD
+  {RGBLIGHT_RAINBOW_MOOD_VARIANTS, RGBLIGHT_FLAG_KEEP_HUE, rainbow_mood_init, rainbow_mood_step},
+#endif
+#if RGBLIGHT_EFFECT_RAINBOW_SWIRL
+  {RGBLIGHT_RAINBOW_SWIRL_VARIANTS, RGBLIGHT_FLAG_KEEP_HUE, rainbow_swirl_init, rainbow_swirl_step},
+#endif
+#if RGBLIGHT_EFFECT_SNAKE
+  {RGBLIGHT_SNAKE_VARIANTS, 0, snake_init, snake_step},
+#endif
+#if RGBLIGHT_EFFECT_KNIGHT
+  {RGBLIGHT_KNIGHT_VARIANTS, 0, knight_init, knight_step},
+#endif
+};
+
+const rgblight_effect_t *rgblight_effect_find(uint8_t mode, uint8_t *variant) {
+  if (mode < 2) {
+    return NULL;
+  }
+  mode -= 2;
+  for (uint8_t i = 0; i < sizeof(rgblight_effects) / sizeof(rgblight_effects[0]); i++) {
+    if (mode < rgblight_effects[i].variants) {
+      *variant = mode;
+      return &rgblight_effects[i];
+    }
+    mode -= rgblight_effects[i].variants;
+  }
+  return NULL;
+}
+#else
+const rgblight_effect_t *rgblight_effect_find(uint8_t mode, uint8_t *variant) {
+  (void)mode;
+  (void)variant;
+  return NULL;
+}
+#endif
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef RGBLIGHT_EFFECTS_H
+#define RGBLIGHT_EFFECTS_H
+
+#include <stdint.h>
+#include "rgblight.h"
+
+/* The state of the running effect. Only one effect runs at a time, so
+ * they share it.
+ */
+typedef union {
+  struct {
+    uint8_t pos;
+  } breathing;
+  struct {
+    uint16_t hue;
+  } rainbow_mood;
+  struct {
+    uint16_t hue;
+    hsv_palette_t palette;
+  } rainbow_swirl;
+  struct {
+    uint8_t pos;
+  } snake;
+  struct {
+    int8_t pos;
+    int8_t direction;
+  } knight;
+} rgblight_effect_state_t;
+
+// The effect ignores hue or val changes, it animates them itself
+#define RGBLIGHT_FLAG_KEEP_HUE (1<<0)
+#define RGBLIGHT_FLAG_KEEP_VAL (1<<1)
+
+/* An effect covers as many modes as it has variants, the variant is the
+ * speed and direction. init() resets the state when the mode is selected,
+ * step() draws the next frame into leds and returns the milliseconds until
+ * the one after it.
+ */
+typedef struct {
+  uint8_t variants;
+  uint8_t flags;
+  void (*init)(rgblight_effect_state_t *state, uint8_t variant);
+  uint16_t (*step)(rgblight_effect_state_t *state, uint8_t variant,
+                   const rgblight_config_t *config, struct cRGB *leds);
+} rgblight_effect_t;
+
+/* The effect of an animated mode and its variant, NULL for the static mode
+ * and the modes of effects that aren't built.
+ */
+const rgblight_effect_t *rgblight_effect_find(uint8_t mode, uint8_t *variant);
+
+#endif
@@ -0,0 +1,124 @@
+#include "progmem.h"
+#include "rgblight_hsv.h"
+
+const uint8_t DIM_CURVE[] PROGMEM = {
+	0, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 6, 6, 6,
+	6, 6, 6, 6, 6, 7, 7, 7, 7, 7, 7, 7, 8, 8, 8, 8,
+	8, 8, 9, 9, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11,
+	11, 11, 12, 12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15,
+	15, 15, 16, 16, 16, 16, 17, 17, 17, 18, 18, 18, 19, 19, 19, 20,
+	20, 20, 21, 21, 22, 22, 22, 23, 23, 24, 24, 25, 25, 25, 26, 26,
+	27, 27, 28, 28, 29, 29, 30, 30, 31, 32, 32, 33, 33, 34, 35, 35,
+	36, 36, 37, 38, 38, 39, 40, 40, 41, 42, 43, 43, 44, 45, 46, 47,
+	48, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62,
+	63, 64, 65, 66, 68, 69, 70, 71, 73, 74, 75, 76, 78, 79, 81, 82,
+	83, 85, 86, 88, 90, 91, 93, 94, 96, 98, 99, 101, 103, 105, 107, 109,
+	110, 112, 114, 116, 118, 121, 123, 125, 127, 129, 132, 134, 136, 139, 141, 144,
+	146, 149, 151, 154, 157, 159, 162, 165, 168, 171, 174, 177, 180, 183, 186, 190,
+	193, 196, 200, 203, 207, 211, 214, 218, 222, 226, 230, 234, 238, 242, 248, 255,
+};
+
+// (delta * f) / 60 for delta * f up to 255 * 60, without a division. Both
+// factors are 16 bit, so the AVR needs a 16x16 multiply, not a 32 bit one.
+static inline uint8_t ramp(uint8_t delta, uint8_t f) {
+  return ((uint32_t)(uint16_t)(delta * f) * (uint16_t)17477) >> 20;
+}
+
+// Splits hue into the 60 degree sector and the position within it
+static inline uint8_t hue_sector(uint16_t *hue) {
+  uint8_t sector = 0;
+  while (*hue >= 60) {
+    *hue -= 60;
+    sector++;
+  }
+  return sector;
+}
+
+// low and high are the levels at the ends of each ramp, up and down the
+// rising and falling channel at this point of the sector
+static void set_sector(uint8_t sector, uint8_t low, uint8_t up, uint8_t down, uint8_t high, struct cRGB *led1) {
+  switch (sector) {
+  case 0:
+    setrgb(high, up, low, led1);
+    break;
+  case 1:
+    setrgb(down, high, low, led1);
+    break;
+  case 2:
+    setrgb(low, high, up, led1);
+    break;
+  case 3:
+    setrgb(low, down, high, led1);
+    break;
+  case 4:
+    setrgb(up, low, high, led1);
+    break;
+  case 5:
+    setrgb(high, low, down, led1);
+    break;
+  default:
+    setrgb(0, 0, 0, led1);
+    break;
+  }
+}
+
+void sethsv(uint16_t hue, uint8_t sat, uint8_t val, struct cRGB *led1) {
+  val = pgm_read_byte(&DIM_CURVE[val]);
+  sat = 255 - pgm_read_byte(&DIM_CURVE[255 - sat]);
+
+  // Acromatic color (gray) when sat is 0, hue doesn't mind
+  uint8_t base = sat ? ((255 - sat) * val) >> 8 : val;
+  uint8_t delta = val - base;
+  uint8_t sector = hue_sector(&hue);
+  set_sector(sector, base, base + ramp(delta, hue), base + ramp(delta, 60 - hue), val, led1);
+}
+
+void setrgb(uint8_t r, uint8_t g, uint8_t b, struct cRGB *led1) {
+  (*led1).r = r;
+  (*led1).g = g;
+  (*led1).b = b;
+}
+
+void hsv_palette_update(hsv_palette_t *palette, uint8_t sat, uint8_t val) {
+  if (palette->valid && palette->sat == sat && palette->val == val) {
+    return;
+  }
+  palette->valid = true;
+  palette->sat = sat;
+  palette->val = val;
+
+  val = pgm_read_byte(&DIM_CURVE[val]);
+  sat = 255 - pgm_read_byte(&DIM_CURVE[255 - sat]);
+  uint8_t base = sat ? ((255 - sat) * val) >> 8 : val;
+  uint8_t delta = val - base;
+  for (uint8_t f = 0; f <= 60; f++) {
+    palette->ramp[f] = base + ramp(delta, f);
+  }
+}
+
+void hsv_palette_get(const hsv_palette_t *palette, uint16_t hue, struct cRGB *led1) {
+  uint8_t sector = hue_sector(&hue);
+  set_sector(sector, palette->ramp[0], palette->ramp[hue], palette->ramp[60 - hue], palette->ramp[60], led1);
+}
+
+void hsv_palette_render(const hsv_palette_t *palette, uint16_t hue, uint16_t hue_step,
+                        struct cRGB *leds, uint8_t count) {
+  const uint8_t *ramp = palette->ramp;
+  uint8_t sector = hue_sector(&hue);
+  uint8_t step_sectors = hue_sector(&hue_step);
+  uint8_t f = hue;
+  for (uint8_t i = 0; i < count; i++) {
+    set_sector(sector, ramp[0], ramp[f], ramp[60 - f], ramp[60], &leds[i]);
+    f += hue_step;
+    sector += step_sectors;
+    if (f >= 60) {
+      f -= 60;
+      sector++;
+    }
+    if (sector >= 6) {
+      sector -= 6;
+    }
+  }
+}
@@ -0,0 +1,40 @@
+#ifndef RGBLIGHT_HSV_H
+#define RGBLIGHT_HSV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#ifdef PROTOCOL_CHIBIOS
+#include "ws2812_spi.h"
+#else
+#include "light_ws2812.h"
+#endif
+
+/* Converts hue (0-359), saturation and brightness to RGB. The DIM_CURVE is
+ * applied to the brightness and to the saturation (inverted), which looks
+ * the most natural.
+ */
+void sethsv(uint16_t hue, uint8_t sat, uint8_t val, struct cRGB *led1);
+void setrgb(uint8_t r, uint8_t g, uint8_t b, struct cRGB *led1);
+
+/* For drawing many LEDs with the same saturation and brightness. Within
+ * each 60 degrees of hue one colour channel ramps between the same 61
+ * levels, so the palette holds those and a colour is three lookups.
+ * hsv_palette_update() only recomputes them when sat or val changed.
+ */
+typedef struct {
+  bool valid;
+  uint8_t sat;
+  uint8_t val;
+  uint8_t ramp[61];
+} hsv_palette_t;
+
+void hsv_palette_update(hsv_palette_t *palette, uint8_t sat, uint8_t val);
+void hsv_palette_get(const hsv_palette_t *palette, uint16_t hue, struct cRGB *led1);
+
+/* Fills count LEDs, the first with hue and each next one hue_step further
+ * round the wheel. Both have to be below 360.
+ */
+void hsv_palette_render(const hsv_palette_t *palette, uint16_t hue, uint16_t hue_step,
+                        struct cRGB *leds, uint8_t count);
+
+#endif
@@ -25,7 +25,9 @@ SOFTWARE.
 #include "serial_link/protocol/byte_stuffer.h"
 #include "serial_link/protocol/frame_validator.h"
 #include "serial_link/protocol/physical.h"
+#include "serial_link/protocol/link_stats.h"
 #include <stdbool.h>
+#include <string.h>
 
 // This implements the "Consistent overhead byte stuffing protocol"
 // https://en.wikipedia.org/wiki/Consistent_Overhead_Byte_Stuffing
@@ -76,6 +78,9 @@ void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
         }
         else {
             // The frame is invalid, so reset
+            if (state->data_pos > 0) {
+                link_stats.links[link].cobs_resets++;
+            }
             init_byte_stuffer_state(state);
         }
     }
@@ -83,6 +88,7 @@ void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
         if (state->data_pos == MAX_FRAME_SIZE) {
             // We exceeded our maximum frame size
             // therefore there's nothing else to do than reset to a new frame
+            link_stats.links[link].cobs_resets++;
             state->next_zero = data;
             state->long_frame = data == 0xFF;
             state->data_pos = 0;
@@ -105,41 +111,75 @@ void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
     }
 }
 
-static void send_block(uint8_t link, uint8_t* start, uint8_t* end, uint8_t num_non_zero) {
-    send_data(link, &num_non_zero, 1);
-    if (end > start) {
-        send_data(link, start, end-start);
+void byte_stuffer_recv_span(uint8_t link, const uint8_t* data, uint16_t size) {
+    byte_stuffer_state_t* state = &states[link];
+    const uint8_t* end = data + size;
+    while (data < end) {
+        if (state->next_zero > 1) {
+            // The rest of the block is plain data, unless the frame is
+            // invalid, so copy up to the next code byte, zero or the end
+            // of the frame buffer at once
+            uint16_t run = state->next_zero - 1;
+            if (run > end - data) {
+                run = end - data;
+            }
+            if (run > MAX_FRAME_SIZE - state->data_pos) {
+                run = MAX_FRAME_SIZE - state->data_pos;
+            }
+            const uint8_t* zero = memchr(data, 0, run);
+            if (zero) {
+                run = zero - data;
+            }
+            memcpy(state->data + state->data_pos, data, run);
+            state->data_pos += run;
+            state->next_zero -= run;
+            data += run;
+            if (data == end) {
+                break;
+            }
+        }
+        byte_stuffer_recv_byte(link, *data++);
     }
 }
 
+// One code byte for every 254 data bytes, one for the final block and the
+// terminating zero
+#define MAX_ENCODED_FRAME_SIZE (MAX_FRAME_SIZE + MAX_FRAME_SIZE / 254 + 2)
+
+// Frames are only sent from the serial link thread, one at a time, so all
+// links can share the encode buffer
+static uint8_t send_buffer[MAX_ENCODED_FRAME_SIZE];
+
 void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
-    const uint8_t zero = 0;
-    if (size > 0) {
-        uint16_t num_non_zero = 1;
+    if (size > 0 && size <= MAX_FRAME_SIZE) {
         uint8_t* end = data + size;
-        uint8_t* start = data;
+        uint8_t* code = send_buffer;
+        uint8_t* out = code + 1;
+        uint8_t num_non_zero = 1;
         while (data < end) {
             if (num_non_zero == 0xFF) {
                 // There's more data after big non-zero block
-                // So send it, and start a new block
-                send_block(link, start, data, num_non_zero);
-                start = data;
+                // So start a new block
+                *code = num_non_zero;
+                code = out++;
                 num_non_zero = 1;
             }
             else {
                 if (*data == 0) {
-                    // A zero encountered, so send the block
-                    send_block(link, start, data, num_non_zero);
-                    start = data + 1;
+                    // A zero encountered, so close the block
+                    *code = num_non_zero;
+                    code = out++;
                     num_non_zero = 1;
                 }
                 else {
+                    *out++ = *data;
                     num_non_zero++;
                 }
                 ++data;
             }
         }
-        send_block(link, start, data, num_non_zero);
-        send_data(link, &zero, 1);
+        *code = num_non_zero;
+        *out++ = 0;
+        send_data(link, send_buffer, out - send_buffer);
     }
 }
@@ -29,6 +29,9 @@ SOFTWARE.
 
 void init_byte_stuffer(void);
 void byte_stuffer_recv_byte(uint8_t link, uint8_t data);
+// Same as calling byte_stuffer_recv_byte for every byte, but copies the
+// data of each COBS block in one go
+void byte_stuffer_recv_span(uint8_t link, const uint8_t* data, uint16_t size);
 void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size);
 
 #endif
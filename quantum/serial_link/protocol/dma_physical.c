@@ -0,0 +1,136 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string.h>
+#include "serial_link/protocol/dma_physical.h"
+#include "serial_link/protocol/byte_stuffer.h"
+#include "serial_link/protocol/link_stats.h"
+#include "serial_link/system/serial_link.h"
+
+#define NUM_LINKS 2
+
+typedef struct {
+    uint8_t buffer[SERIAL_LINK_DMA_RX_SIZE];
+    // The DMA only reports the position it writes next, so there is no
+    // telling if it has lapped the reader
+    uint16_t read_pos;
+} rx_ring_t;
+
+typedef struct {
+    uint8_t buffer[SERIAL_LINK_DMA_TX_SIZE];
+    // Moved by the serial thread only
+    uint16_t write_pos;
+    // The first byte not sent yet and the size of the running transfer,
+    // moved by the interrupt
+    volatile uint16_t read_pos;
+    volatile uint16_t sending;
+} tx_ring_t;
+
+static rx_ring_t rx_rings[NUM_LINKS];
+static tx_ring_t tx_rings[NUM_LINKS];
+
+void init_dma_physical(void) {
+    uint8_t link;
+    for (link=0;link<NUM_LINKS;link++) {
+        rx_rings[link].read_pos = 0;
+        tx_rings[link].write_pos = 0;
+        tx_rings[link].read_pos = 0;
+        tx_rings[link].sending = 0;
+        serial_link_dma_init(link, rx_rings[link].buffer, SERIAL_LINK_DMA_RX_SIZE);
+    }
+}
+
+static uint16_t recv_link(uint8_t link) {
+    rx_ring_t* ring = &rx_rings[link];
+    uint16_t write_pos = serial_link_dma_rx_position(link);
+    // Some DMA controllers report the end of the buffer instead of 0
+    if (write_pos >= SERIAL_LINK_DMA_RX_SIZE) {
+        write_pos = 0;
+    }
+    uint16_t read_pos = ring->read_pos;
+    uint16_t received = 0;
+    if (write_pos < read_pos) {
+        received = SERIAL_LINK_DMA_RX_SIZE - read_pos;
+        byte_stuffer_recv_span(link, ring->buffer + read_pos, received);
+        read_pos = 0;
+    }
+    if (write_pos > read_pos) {
+        byte_stuffer_recv_span(link, ring->buffer + read_pos, write_pos - read_pos);
+        received += write_pos - read_pos;
+    }
+    ring->read_pos = write_pos;
+    return received;
+}
+
+uint16_t dma_physical_recv(void) {
+    uint16_t received = 0;
+    uint8_t link;
+    for (link=0;link<NUM_LINKS;link++) {
+        received += recv_link(link);
+    }
+    return received;
+}
+
+static void start_tx_i(uint8_t link) {
+    tx_ring_t* ring = &tx_rings[link];
+    uint16_t read_pos = ring->read_pos;
+    uint16_t write_pos = ring->write_pos;
+    if (ring->sending || read_pos == write_pos) {
+        return;
+    }
+    // Up to the end of the buffer, the rest goes with the next transfer
+    uint16_t end = write_pos > read_pos ? write_pos : SERIAL_LINK_DMA_TX_SIZE;
+    ring->sending = end - read_pos;
+    serial_link_dma_start_tx_i(link, ring->buffer + read_pos, end - read_pos);
+}
+
+bool dma_physical_send(uint8_t link, const uint8_t* data, uint16_t size) {
+    tx_ring_t* ring = &tx_rings[link];
+    uint16_t write_pos = ring->write_pos;
+    // The interrupt only frees space, so this is never more than there is.
+    // One byte stays unused to tell a full buffer from an empty one.
+    uint16_t free = (ring->read_pos + SERIAL_LINK_DMA_TX_SIZE - write_pos - 1) % SERIAL_LINK_DMA_TX_SIZE;
+    if (size > free) {
+        link_stats.links[link].tx_drops++;
+        return false;
+    }
+    uint16_t first = SERIAL_LINK_DMA_TX_SIZE - write_pos;
+    if (first > size) {
+        first = size;
+    }
+    memcpy(ring->buffer + write_pos, data, first);
+    memcpy(ring->buffer, data + first, size - first);
+    serial_link_lock();
+    ring->write_pos = (write_pos + size) % SERIAL_LINK_DMA_TX_SIZE;
+    start_tx_i(link);
+    serial_link_unlock();
+    return true;
+}
+
+void dma_physical_tx_done_i(uint8_t link) {
+    tx_ring_t* ring = &tx_rings[link];
+    ring->read_pos = (ring->read_pos + ring->sending) % SERIAL_LINK_DMA_TX_SIZE;
+    ring->sending = 0;
+    start_tx_i(link);
+}
@@ -0,0 +1,78 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SERIAL_LINK_DMA_PHYSICAL_H
+#define SERIAL_LINK_DMA_PHYSICAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The physical layer of keyboards that set SERIAL_LINK_DMA_ENABLE, in
+// place of the ChibiOS serial drivers. Each link receives into a circular
+// DMA buffer and sends from another one, so the serial thread neither polls
+// nor copies the data byte by byte.
+//
+// The keyboard drives the UART and DMA of its MCU through the hooks at the
+// end, everything else is here and runs on the host in the loopback tests.
+// The links are UP_LINK and DOWN_LINK.
+
+// Needs to hold everything that can arrive while the serial thread is
+// busy, the DMA overwrites data that hasn't been read yet
+#ifndef SERIAL_LINK_DMA_RX_SIZE
+#define SERIAL_LINK_DMA_RX_SIZE 256
+#endif
+
+// Frames that don't fit while the previous ones are being sent are
+// dropped, it has to hold more than the largest encoded frame
+#ifndef SERIAL_LINK_DMA_TX_SIZE
+#define SERIAL_LINK_DMA_TX_SIZE 256
+#endif
+
+void init_dma_physical(void);
+// Passes everything received since the last call to the byte stuffer, in
+// at most two spans per link. Returns the number of bytes.
+uint16_t dma_physical_recv(void);
+// Queues the data after the bytes still being sent, and starts a transfer
+// if none is running. Returns false if it doesn't fit.
+bool dma_physical_send(uint8_t link, const uint8_t* data, uint16_t size);
+// Called from the transmit complete interrupt, starts the next transfer
+void dma_physical_tx_done_i(uint8_t link);
+
+// Implemented by the keyboard
+
+// Set up the UART of the link at SERIAL_LINK_BAUD, and start receiving into
+// the buffer with a circular DMA transfer. The idle line interrupt of the
+// UART and the half and full transfer interrupts of the DMA call
+// serial_link_dma_rx_event_i().
+void serial_link_dma_init(uint8_t link, uint8_t* rx_buffer, uint16_t rx_size);
+// The index in the receive buffer the DMA writes next
+uint16_t serial_link_dma_rx_position(uint8_t link);
+// Start one DMA transfer of the data, with the system locked. When it is
+// complete, the interrupt calls dma_physical_tx_done_i().
+void serial_link_dma_start_tx_i(uint8_t link, const uint8_t* data, uint16_t size);
+
+// Implemented by the serial link, wakes up the serial thread
+void serial_link_dma_rx_event_i(uint8_t link);
+
+#endif
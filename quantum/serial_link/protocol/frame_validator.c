@@ -25,6 +25,7 @@ SOFTWARE.
 #include "serial_link/protocol/frame_validator.h"
 #include "serial_link/protocol/frame_router.h"
 #include "serial_link/protocol/byte_stuffer.h"
+#include "serial_link/protocol/link_stats.h"
 #include <string.h>
 
 const uint32_t poly8_lookup[256] =
@@ -95,6 +96,20 @@ const uint32_t poly8_lookup[256] =
  0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
 };
 
+#if SERIAL_LINK_CRC32 == CRC32_SLICE_BY_4
+#define CRC32_SLICES 4
+#elif SERIAL_LINK_CRC32 == CRC32_SLICE_BY_8
+#define CRC32_SLICES 8
+#endif
+
+#include "serial_link/protocol/crc_tables.h"
+
+#if SERIAL_LINK_CRC_SIZE == 4
+
+typedef uint32_t frame_crc_t;
+
+#if SERIAL_LINK_CRC32 == CRC32_BYTEWISE
+
 static uint32_t crc32_byte(uint8_t *p, uint32_t bytelength)
 {
     uint32_t crc = 0xffffffff;
@@ -103,19 +118,149 @@ static uint32_t crc32_byte(uint8_t *p, uint32_t bytelength)
     return (crc ^ 0xffffffff);
 }
 
+#define frame_crc crc32_byte
+
+#elif SERIAL_LINK_CRC32 == CRC32_SLICE_BY_4 || SERIAL_LINK_CRC32 == CRC32_SLICE_BY_8
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The sliced CRC32 only supports little endian targets"
+#endif
+
+#define SLICE(k, v) crc32_slice_lookup[(k) - 1][(uint8_t)(v)]
+
+static uint32_t crc32_slice(uint8_t *p, uint32_t bytelength)
+{
+    uint32_t crc = 0xffffffff;
+    while (bytelength >= CRC32_SLICES) {
+        uint32_t one;
+        // memcpy since the frames have no alignment guarantees
+        memcpy(&one, p, 4);
+        one ^= crc;
+#if CRC32_SLICES == 8
+        uint32_t two;
+        memcpy(&two, p + 4, 4);
+        crc = SLICE(7, one) ^ SLICE(6, one >> 8) ^ SLICE(5, one >> 16) ^ SLICE(4, one >> 24) ^
+              SLICE(3, two) ^ SLICE(2, two >> 8) ^ SLICE(1, two >> 16) ^ poly8_lookup[two >> 24];
+#else
+        crc = SLICE(3, one) ^ SLICE(2, one >> 8) ^ SLICE(1, one >> 16) ^ poly8_lookup[one >> 24];
+#endif
+        p += CRC32_SLICES;
+        bytelength -= CRC32_SLICES;
+    }
+    while (bytelength-- !=0) crc = poly8_lookup[((uint8_t) crc ^ *(p++))] ^ (crc >> 8);
+    return (crc ^ 0xffffffff);
+}
+
+#define frame_crc crc32_slice
+
+#elif SERIAL_LINK_CRC32 == CRC32_HARDWARE
+
+#include "serial_link/system/serial_link.h"
+
+#if defined(K20x)
+
+// The Kinetis CRC module, configured for the reflected CRC32
+#define K20_SIM_SCGC6 (*(volatile uint32_t*)0x4004803C)
+#define K20_SIM_SCGC6_CRC (1u << 18)
+#define K20_CRC_DATA (*(volatile uint32_t*)0x40032000)
+#define K20_CRC_DATALL (*(volatile uint8_t*)0x40032000)
+#define K20_CRC_GPOLY (*(volatile uint32_t*)0x40032004)
+#define K20_CRC_CTRL (*(volatile uint32_t*)0x40032008)
+#define K20_CRC_CTRL_TOT_BITS (1u << 30)
+#define K20_CRC_CTRL_TOTR_BITS_AND_BYTES (2u << 28)
+#define K20_CRC_CTRL_FXOR (1u << 26)
+#define K20_CRC_CTRL_WAS (1u << 25)
+#define K20_CRC_CTRL_TCRC (1u << 24)
+
+static uint32_t crc32_hardware(uint8_t *p, uint32_t bytelength)
+{
+    const uint32_t ctrl = K20_CRC_CTRL_TOT_BITS | K20_CRC_CTRL_TOTR_BITS_AND_BYTES |
+                          K20_CRC_CTRL_FXOR | K20_CRC_CTRL_TCRC;
+    serial_link_lock();
+    K20_SIM_SCGC6 |= K20_SIM_SCGC6_CRC;
+    K20_CRC_CTRL = ctrl;
+    K20_CRC_GPOLY = 0x04C11DB7;
+    K20_CRC_CTRL = ctrl | K20_CRC_CTRL_WAS;
+    K20_CRC_DATA = 0xffffffff;
+    K20_CRC_CTRL = ctrl;
+    while (bytelength-- !=0) K20_CRC_DATALL = *(p++);
+    uint32_t crc = K20_CRC_DATA;
+    serial_link_unlock();
+    return crc;
+}
+
+#elif defined(CRC_CR_REV_IN) && defined(CRC_CR_REV_OUT) && defined(RCC_AHBENR_CRCEN)
+
+// The STM32 CRC unit always uses the CRC32 polynomial, the input is
+// bit reversed per byte and the output reversed to get the reflected CRC
+static uint32_t crc32_hardware(uint8_t *p, uint32_t bytelength)
+{
+    serial_link_lock();
+    RCC->AHBENR |= RCC_AHBENR_CRCEN;
+    CRC->INIT = 0xffffffff;
+    CRC->CR = CRC_CR_REV_IN_0 | CRC_CR_REV_OUT | CRC_CR_RESET;
+    while (bytelength-- !=0) *(volatile uint8_t*)&CRC->DR = *(p++);
+    uint32_t crc = CRC->DR;
+    serial_link_unlock();
+    return (crc ^ 0xffffffff);
+}
+
+#else
+#error "CRC32_HARDWARE is only supported on the Kinetis K20 and STM32s with CRC input/output reversal"
+#endif
+
+#define frame_crc crc32_hardware
+
+#else
+#error "Unknown SERIAL_LINK_CRC32 back end"
+#endif
+
+#elif SERIAL_LINK_CRC_SIZE == 2
+
+typedef uint16_t frame_crc_t;
+
+// CRC-16/CCITT-FALSE
+static uint16_t crc16_byte(uint8_t *p, uint32_t bytelength)
+{
+    uint16_t crc = 0xffff;
+    while (bytelength-- !=0) crc = crc16_lookup[(uint8_t)(crc >> 8) ^ *(p++)] ^ (crc << 8);
+    return crc;
+}
+
+#define frame_crc crc16_byte
+
+#elif SERIAL_LINK_CRC_SIZE == 1
+
+typedef uint8_t frame_crc_t;
+
+static uint8_t crc8_byte(uint8_t *p, uint32_t bytelength)
+{
+    uint8_t crc = 0;
+    while (bytelength-- !=0) crc = crc8_lookup[crc ^ *(p++)];
+    return crc;
+}
+
+#define frame_crc crc8_byte
+
+#endif
+
 void validator_recv_frame(uint8_t link, uint8_t* data, uint16_t size) {
-    if (size > 4) {
-        uint32_t frame_crc;
-        memcpy(&frame_crc, data + size -4, 4);
-        uint32_t expected_crc = crc32_byte(data, size - 4);
-        if (frame_crc == expected_crc) {
-            route_incoming_frame(link, data, size-4);
+    if (size > SERIAL_LINK_CRC_SIZE) {
+        frame_crc_t received_crc;
+        memcpy(&received_crc, data + size - SERIAL_LINK_CRC_SIZE, SERIAL_LINK_CRC_SIZE);
+        frame_crc_t expected_crc = frame_crc(data, size - SERIAL_LINK_CRC_SIZE);
+        if (received_crc == expected_crc) {
+            link_stats.links[link].frames++;
+            route_incoming_frame(link, data, size - SERIAL_LINK_CRC_SIZE);
+        }
+        else {
+            link_stats.links[link].crc_errors++;
         }
     }
 }
 
 void validator_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
-    uint32_t crc = crc32_byte(data, size);
-    memcpy(data + size, &crc, 4);
-    byte_stuffer_send_frame(link, data, size + 4);
+    frame_crc_t crc = frame_crc(data, size);
+    memcpy(data + size, &crc, SERIAL_LINK_CRC_SIZE);
+    byte_stuffer_send_frame(link, data, size + SERIAL_LINK_CRC_SIZE);
 }
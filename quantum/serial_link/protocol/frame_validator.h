@@ -27,8 +27,30 @@ SOFTWARE.
 
 #include <stdint.h>
 
+// Size of the frame check appended to every frame, 4 for CRC32,
+// 2 for CRC-16/CCITT or 1 for CRC-8. Both halves need the same setting.
+#ifndef SERIAL_LINK_CRC_SIZE
+#define SERIAL_LINK_CRC_SIZE 4
+#endif
+
+// How the CRC32 is computed. Slicing trades 3 or 7 extra KB of lookup
+// tables for processing 4 or 8 bytes per step. The hardware CRC unit is
+// supported on the Kinetis K20 and on STM32s with input/output reversal.
+#define CRC32_BYTEWISE 0
+#define CRC32_SLICE_BY_4 1
+#define CRC32_SLICE_BY_8 2
+#define CRC32_HARDWARE 3
+
+#ifndef SERIAL_LINK_CRC32
+#define SERIAL_LINK_CRC32 CRC32_BYTEWISE
+#endif
+
+#if SERIAL_LINK_CRC_SIZE != 4 && SERIAL_LINK_CRC_SIZE != 2 && SERIAL_LINK_CRC_SIZE != 1
+#error "SERIAL_LINK_CRC_SIZE must be 1, 2 or 4"
+#endif
+
 void validator_recv_frame(uint8_t link, uint8_t* data, uint16_t size);
-// The buffer pointed to by the data needs 4 additional bytes
+// The buffer pointed to by the data needs SERIAL_LINK_CRC_SIZE additional bytes
 void validator_send_frame(uint8_t link, uint8_t* data, uint16_t size);
 
 #endif
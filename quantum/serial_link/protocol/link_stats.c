@@ -0,0 +1,40 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "serial_link/protocol/link_stats.h"
+
+link_stats_t link_stats;
+
+void link_stats_add_rtt(uint16_t rtt_ms) {
+    if (link_stats.rtt_ms == 0) {
+        link_stats.rtt_ms = rtt_ms;
+    }
+    else {
+        // Moving average over about 8 samples, like TCP's smoothed RTT
+        link_stats.rtt_ms = ((uint32_t)link_stats.rtt_ms * 7 + rtt_ms + 4) / 8;
+    }
+    if (rtt_ms > link_stats.rtt_max_ms) {
+        link_stats.rtt_max_ms = rtt_ms;
+    }
+}
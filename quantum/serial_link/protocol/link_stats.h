@@ -0,0 +1,68 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SERIAL_LINK_LINK_STATS_H
+#define SERIAL_LINK_LINK_STATS_H
+
+#include <stdint.h>
+
+// Always on error and traffic counters, for judging the baud rate and
+// cables. The counters wrap around.
+
+typedef struct {
+    // Frames with a valid CRC
+    uint32_t frames;
+    uint32_t crc_errors;
+    // Frames thrown away by the COBS decoder, for an unexpected zero or
+    // being too long
+    uint32_t cobs_resets;
+    // The serial driver only raises event flags for these, and the flags
+    // of all errors between two wakeups of the link thread merge into one.
+    // So they count wakeups that saw an error, a busy or noisy link has
+    // more errors than this.
+    uint32_t overrun_events;
+    // Parity, framing and noise errors and breaks
+    uint32_t line_error_events;
+    // Frames that didn't fit into the DMA transmit buffer, with
+    // SERIAL_LINK_DMA_ENABLE
+    uint32_t tx_drops;
+} link_counters_t;
+
+typedef struct {
+    // Indexed by UP_LINK and DOWN_LINK
+    link_counters_t links[2];
+    // The rest is fed by the message channel alone and stays at 0 when
+    // nothing is sent over it, the shared objects are never acknowledged.
+    // Message channel frames sent again after a timeout
+    uint32_t retransmits;
+    // Message channel round trip, smoothed, and the maximum
+    uint16_t rtt_ms;
+    uint16_t rtt_max_ms;
+} link_stats_t;
+
+extern link_stats_t link_stats;
+
+void link_stats_add_rtt(uint16_t rtt_ms);
+
+#endif
@@ -0,0 +1,216 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "serial_link/protocol/message_channel.h"
+#include "serial_link/protocol/frame_router.h"
+#include "serial_link/protocol/link_stats.h"
+#include <string.h>
+
+// A frame starts with its sequence number and the sequence number of the
+// next frame expected from the peer, which acknowledges everything before
+// it. Frames with just the header only carry the acknowledgement. The
+// messages follow as a size byte and the data.
+#define HEADER_SIZE 2
+
+typedef struct {
+    uint16_t sent_time;
+    // Retransmitted frames give no round trip time, it's not known which
+    // copy was acknowledged
+    bool retransmitted;
+    uint8_t size;
+    uint8_t data[HEADER_SIZE + SERIAL_LINK_MESSAGE_FRAME_SIZE + LOCAL_OBJECT_EXTRA];
+} message_frame_t;
+
+typedef struct {
+    message_frame_t window[SERIAL_LINK_MESSAGE_WINDOW];
+    // Frames first_unacked up to next_seq are in the window, the ones
+    // from next_to_send haven't been sent yet
+    uint8_t first_unacked;
+    uint8_t next_to_send;
+    uint8_t next_seq;
+    bool restart_timer;
+    uint16_t sent_time;
+    uint8_t expected_seq;
+    bool ack_pending;
+    bool rtt_pending;
+    uint16_t rtt_sent_time;
+    uint8_t batch_size;
+    uint8_t batch[SERIAL_LINK_MESSAGE_FRAME_SIZE];
+} message_channel_t;
+
+// Indexed by peer, the master is 0
+static message_channel_t channels[NUM_SLAVES + 1];
+
+static uint8_t seq_distance(uint8_t from, uint8_t to) {
+    return (uint8_t)(to - from);
+}
+
+void init_message_channel(void) {
+    memset(channels, 0, sizeof(channels));
+}
+
+bool message_channel_send(uint8_t peer, const void* data, uint8_t size) {
+    if (peer > NUM_SLAVES) {
+        return false;
+    }
+    message_channel_t* channel = &channels[peer];
+    bool queued = false;
+    serial_link_lock();
+    if (channel->batch_size + 1 + size <= SERIAL_LINK_MESSAGE_FRAME_SIZE) {
+        channel->batch[channel->batch_size] = size;
+        memcpy(channel->batch + channel->batch_size + 1, data, size);
+        channel->batch_size += 1 + size;
+        queued = true;
+    }
+    serial_link_unlock();
+    if (queued) {
+        signal_data_written();
+    }
+    return queued;
+}
+
+static void send_frame(uint8_t peer, uint8_t* data, uint8_t size) {
+    message_channel_t* channel = &channels[peer];
+    data[1] = channel->expected_seq;
+    data[size] = MESSAGE_CHANNEL_ID;
+    channel->ack_pending = false;
+    router_send_frame(peer == 0 ? 0 : 1 << (peer - 1), data, size + 1);
+}
+
+static void recv_ack(message_channel_t* channel, uint8_t ack) {
+    uint8_t acked = seq_distance(channel->first_unacked, ack);
+    if (acked == 0 || acked > seq_distance(channel->first_unacked, channel->next_seq)) {
+        return;
+    }
+    if (seq_distance(channel->first_unacked, channel->next_to_send) < acked) {
+        channel->next_to_send = ack;
+    }
+    message_frame_t* last_acked = &channel->window[(uint8_t)(ack - 1) % SERIAL_LINK_MESSAGE_WINDOW];
+    if (!last_acked->retransmitted) {
+        // The time is taken on the next update
+        channel->rtt_pending = true;
+        channel->rtt_sent_time = last_acked->sent_time;
+    }
+    channel->first_unacked = ack;
+    channel->restart_timer = true;
+}
+
+static bool valid_messages(const uint8_t* data, uint16_t size) {
+    uint16_t pos = 0;
+    while (pos < size) {
+        pos += 1 + data[pos];
+    }
+    return pos == size;
+}
+
+void message_channel_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
+    if (from > NUM_SLAVES || size < HEADER_SIZE) {
+        return;
+    }
+    message_channel_t* channel = &channels[from];
+    recv_ack(channel, data[1]);
+    if (size == HEADER_SIZE) {
+        return;
+    }
+    if (data[0] == channel->expected_seq && valid_messages(data + HEADER_SIZE, size - HEADER_SIZE)) {
+        channel->expected_seq++;
+        uint16_t pos = HEADER_SIZE;
+        while (pos < size) {
+            message_channel_received(from, data + pos + 1, data[pos]);
+            pos += 1 + data[pos];
+        }
+    }
+    // Acknowledge duplicates too, the previous acknowledgement was lost
+    channel->ack_pending = true;
+}
+
+static uint16_t update_channel(uint8_t peer, uint16_t time_ms) {
+    message_channel_t* channel = &channels[peer];
+    uint8_t in_flight = seq_distance(channel->first_unacked, channel->next_seq);
+
+    if (channel->rtt_pending) {
+        channel->rtt_pending = false;
+        link_stats_add_rtt(time_ms - channel->rtt_sent_time);
+    }
+
+    if (in_flight < SERIAL_LINK_MESSAGE_WINDOW && channel->batch_size > 0) {
+        message_frame_t* frame = &channel->window[channel->next_seq % SERIAL_LINK_MESSAGE_WINDOW];
+        frame->data[0] = channel->next_seq;
+        serial_link_lock();
+        memcpy(frame->data + HEADER_SIZE, channel->batch, channel->batch_size);
+        frame->size = HEADER_SIZE + channel->batch_size;
+        channel->batch_size = 0;
+        serial_link_unlock();
+        frame->sent_time = time_ms;
+        frame->retransmitted = false;
+        if (in_flight == 0) {
+            channel->restart_timer = true;
+        }
+        channel->next_seq++;
+        in_flight++;
+    }
+
+    if (channel->restart_timer) {
+        channel->restart_timer = false;
+        channel->sent_time = time_ms;
+    }
+    uint16_t elapsed = time_ms - channel->sent_time;
+    if (in_flight > 0 && elapsed >= SERIAL_LINK_MESSAGE_TIMEOUT_MS) {
+        // Go back to the first frame that wasn't acknowledged
+        uint8_t seq;
+        for (seq = channel->first_unacked; seq != channel->next_to_send; seq++) {
+            channel->window[seq % SERIAL_LINK_MESSAGE_WINDOW].retransmitted = true;
+            link_stats.retransmits++;
+        }
+        channel->next_to_send = channel->first_unacked;
+        channel->sent_time = time_ms;
+        elapsed = 0;
+    }
+
+    while (channel->next_to_send != channel->next_seq) {
+        message_frame_t* frame = &channel->window[channel->next_to_send % SERIAL_LINK_MESSAGE_WINDOW];
+        send_frame(peer, frame->data, frame->size);
+        channel->next_to_send++;
+    }
+
+    if (channel->ack_pending) {
+        uint8_t ack[HEADER_SIZE + LOCAL_OBJECT_EXTRA];
+        ack[0] = 0;
+        send_frame(peer, ack, HEADER_SIZE);
+    }
+
+    return in_flight > 0 ? SERIAL_LINK_MESSAGE_TIMEOUT_MS - elapsed : UINT16_MAX;
+}
+
+uint16_t update_message_channel(uint16_t time_ms) {
+    uint16_t wait = UINT16_MAX;
+    uint8_t peer;
+    for (peer = 0; peer <= NUM_SLAVES; peer++) {
+        uint16_t channel_wait = update_channel(peer, time_ms);
+        if (channel_wait < wait) {
+            wait = channel_wait;
+        }
+    }
+    return wait;
+}
@@ -0,0 +1,79 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SERIAL_LINK_MESSAGE_CHANNEL_H
+#define SERIAL_LINK_MESSAGE_CHANNEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "serial_link/protocol/transport.h"
+
+// An ordered and acknowledged message channel between the master and each
+// slave, for events that must not be dropped or coalesced like the remote
+// objects are. Messages queued between two updates of the serial link are
+// batched into one frame, and up to SERIAL_LINK_MESSAGE_WINDOW frames can
+// be waiting for an acknowledgement before the channel stops sending.
+// Lost frames are sent again, along with the ones after them, after
+// SERIAL_LINK_MESSAGE_TIMEOUT_MS.
+
+#ifndef SERIAL_LINK_MESSAGE_WINDOW
+#define SERIAL_LINK_MESSAGE_WINDOW 4
+#endif
+
+// The frames are kept in window[seq % SERIAL_LINK_MESSAGE_WINDOW], with an
+// 8 bit seq that wraps, so the window has to divide 256
+#if SERIAL_LINK_MESSAGE_WINDOW & (SERIAL_LINK_MESSAGE_WINDOW - 1) || SERIAL_LINK_MESSAGE_WINDOW > 128
+#error "SERIAL_LINK_MESSAGE_WINDOW must be a power of two, up to 128"
+#endif
+
+// The message bytes per frame, each message takes its size plus one
+#ifndef SERIAL_LINK_MESSAGE_FRAME_SIZE
+#define SERIAL_LINK_MESSAGE_FRAME_SIZE 32
+#endif
+
+#ifndef SERIAL_LINK_MESSAGE_TIMEOUT_MS
+#define SERIAL_LINK_MESSAGE_TIMEOUT_MS 20
+#endif
+
+// The transport object id that the channel frames use
+#define MESSAGE_CHANNEL_ID 0xFF
+
+#if SERIAL_LINK_MAX_REMOTE_OBJECTS >= MESSAGE_CHANNEL_ID
+#error "SERIAL_LINK_MAX_REMOTE_OBJECTS must be less than 255, the last id is used by the message channel"
+#endif
+
+void init_message_channel(void);
+// Queues a message to the peer, which is 0 for the master and 1 to
+// SERIAL_LINK_NUM_SLAVES for the slaves. Returns false if the message
+// doesn't fit into the frame that is being batched.
+bool message_channel_send(uint8_t peer, const void* data, uint8_t size);
+void message_channel_recv_frame(uint8_t from, uint8_t* data, uint16_t size);
+// Sends the batched messages, acknowledgements and retransmissions.
+// Returns the number of milliseconds until it needs to be called again.
+uint16_t update_message_channel(uint16_t time_ms);
+
+// Called for every received message, in order
+void message_channel_received(uint8_t peer, const uint8_t* data, uint8_t size);
+
+#endif
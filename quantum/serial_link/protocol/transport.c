@@ -25,17 +25,190 @@ SOFTWARE.
 #include "serial_link/protocol/transport.h"
 #include "serial_link/protocol/frame_router.h"
 #include "serial_link/protocol/triple_buffered_object.h"
+#include "serial_link/protocol/message_channel.h"
 #include <string.h>
+#include <stdbool.h>
 
-#define MAX_REMOTE_OBJECTS 16
 static remote_object_t* remote_objects[MAX_REMOTE_OBJECTS];
 static uint32_t num_remote_objects = 0;
 
-void add_remote_objects(remote_object_t** _remote_objects, uint32_t _num_remote_objects) {
+#define DELTA_SNAPSHOT 0
+#define DELTA_CHANGES 1
+#define DELTA_HEARTBEAT 2
+
+#define DELTA_HEADER(kind, seq) (((kind) << 6) | ((seq) & 0x3F))
+#define DELTA_KIND(header) ((header) >> 6)
+#define DELTA_SEQ(header) ((header) & 0x3F)
+
+typedef struct {
+    uint8_t seq;
+    uint8_t frames_to_snapshot;
+    // A delta went out since the last snapshot
+    uint8_t delta_sent;
+    uint8_t last[];
+} delta_sender_t;
+
+typedef struct {
+    uint8_t seq;
+    uint8_t in_sync;
+    uint8_t object[];
+} delta_receiver_t;
+
+static delta_sender_t* get_delta_sender(remote_object_t* obj) {
+    uint8_t* start = obj->buffer + LOCAL_OBJECT_SIZE(obj->object_size);
+    start += NUM_SLAVES * REMOTE_OBJECT_SIZE(obj->object_size);
+    return (delta_sender_t*)start;
+}
+
+static delta_receiver_t* get_delta_receiver(remote_object_t* obj, uint8_t slave) {
+    uint8_t* start = (uint8_t*)get_delta_sender(obj);
+    start += DELTA_SENDER_SIZE(obj->object_size, obj->element_size);
+    start += slave * DELTA_RECEIVER_SIZE(obj->object_size);
+    return (delta_receiver_t*)start;
+}
+
+// Encodes the object as a snapshot, delta or heartbeat, depending on what
+// changed since the last frame, and returns the size of the frame. The
+// first heartbeat after a delta is sent as a snapshot instead, so a
+// receiver that lost the delta is back in sync one heartbeat later.
+static uint16_t delta_encode(remote_object_t* obj, const uint8_t* object, uint8_t* frame) {
+    delta_sender_t* sender = get_delta_sender(obj);
+    uint16_t size = obj->object_size;
+    uint8_t element_size = obj->element_size;
+    uint16_t num_elements = size / element_size;
+    uint16_t bitmap_size = DELTA_BITMAP_SIZE(size, element_size);
+    uint8_t* bitmap = frame + 1;
+    uint8_t* out = bitmap + bitmap_size;
+    memset(bitmap, 0, bitmap_size);
+    uint16_t i;
+    for (i=0;i<num_elements;i++) {
+        const uint8_t* element = object + i * element_size;
+        if (memcmp(element, sender->last + i * element_size, element_size) != 0) {
+            bitmap[i / 8] |= 1 << (i & 7);
+            memcpy(out, element, element_size);
+            out += element_size;
+        }
+    }
+
+    uint16_t frame_size;
+    bool unchanged = out == bitmap + bitmap_size;
+    if (sender->frames_to_snapshot == 0 || out - frame >= 1 + size ||
+            (unchanged && sender->delta_sent)) {
+        sender->seq++;
+        sender->frames_to_snapshot = SERIAL_LINK_DELTA_SNAPSHOT_INTERVAL;
+        sender->delta_sent = false;
+        frame[0] = DELTA_HEADER(DELTA_SNAPSHOT, sender->seq);
+        memcpy(frame + 1, object, size);
+        frame_size = 1 + size;
+    }
+    else if (unchanged) {
+        sender->frames_to_snapshot--;
+        frame[0] = DELTA_HEADER(DELTA_HEARTBEAT, sender->seq);
+        frame_size = 1;
+    }
+    else {
+        sender->seq++;
+        sender->frames_to_snapshot--;
+        sender->delta_sent = true;
+        frame[0] = DELTA_HEADER(DELTA_CHANGES, sender->seq);
+        frame_size = out - frame;
+    }
+    memcpy(sender->last, object, size);
+    return frame_size;
+}
+
+// Applies the frame to the received object, returns true if it changed.
+// A missed frame takes the receiver out of sync until the next snapshot.
+static bool delta_decode(remote_object_t* obj, delta_receiver_t* receiver, const uint8_t* frame, uint16_t frame_size) {
+    uint16_t size = obj->object_size;
+    uint8_t element_size = obj->element_size;
+    if (frame_size == 0) {
+        return false;
+    }
+    uint8_t seq = DELTA_SEQ(frame[0]);
+    switch (DELTA_KIND(frame[0])) {
+    case DELTA_SNAPSHOT:
+        if (frame_size != 1 + size) {
+            return false;
+        }
+        memcpy(receiver->object, frame + 1, size);
+        receiver->seq = seq;
+        receiver->in_sync = true;
+        return true;
+    case DELTA_HEARTBEAT:
+        if (frame_size == 1 && seq != receiver->seq) {
+            receiver->in_sync = false;
+        }
+        return false;
+    case DELTA_CHANGES: {
+        if (!receiver->in_sync || seq != DELTA_SEQ(receiver->seq + 1)) {
+            receiver->in_sync = false;
+            return false;
+        }
+        uint16_t num_elements = size / element_size;
+        uint16_t bitmap_size = DELTA_BITMAP_SIZE(size, element_size);
+        const uint8_t* bitmap = frame + 1;
+        const uint8_t* in = bitmap + bitmap_size;
+        uint16_t expected_size = 1 + bitmap_size;
+        uint16_t i;
+        if (frame_size < expected_size) {
+            receiver->in_sync = false;
+            return false;
+        }
+        for (i=0;i<num_elements;i++) {
+            if (bitmap[i / 8] & (1 << (i & 7))) {
+                expected_size += element_size;
+            }
+        }
+        if (frame_size != expected_size) {
+            receiver->in_sync = false;
+            return false;
+        }
+        for (i=0;i<num_elements;i++) {
+            if (bitmap[i / 8] & (1 << (i & 7))) {
+                memcpy(receiver->object + i * element_size, in, element_size);
+                in += element_size;
+            }
+        }
+        receiver->seq = seq;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+uint32_t remote_object_memory(remote_object_t* obj) {
+    uint32_t size = sizeof(remote_object_t);
+    switch (obj->object_type) {
+    case MASTER_TO_ALL_SLAVES:
+        size += LOCAL_OBJECT_SIZE(obj->object_size) + REMOTE_OBJECT_SIZE(obj->object_size);
+        break;
+    case MASTER_TO_SINGLE_SLAVE:
+        size += NUM_SLAVES * LOCAL_OBJECT_SIZE(obj->object_size) + REMOTE_OBJECT_SIZE(obj->object_size);
+        break;
+    case SLAVE_TO_MASTER:
+        size += LOCAL_OBJECT_SIZE(obj->object_size) + NUM_SLAVES * REMOTE_OBJECT_SIZE(obj->object_size);
+        break;
+    case SLAVE_TO_MASTER_DELTA:
+        size += LOCAL_OBJECT_SIZE(obj->object_size) + NUM_SLAVES * REMOTE_OBJECT_SIZE(obj->object_size);
+        size += DELTA_STATE_SIZE(obj->object_size, obj->element_size);
+        break;
+    }
+    // Padded like the struct holding the object
+    uint32_t align = __alignof__(remote_object_t);
+    return (size + align - 1) / align * align;
+}
+
+bool add_remote_objects(remote_object_t** _remote_objects, uint32_t _num_remote_objects) {
     unsigned int i;
     for(i=0;i<_num_remote_objects;i++) {
+        if (num_remote_objects == MAX_REMOTE_OBJECTS) {
+            return false;
+        }
         remote_object_t* obj = _remote_objects[i];
         remote_objects[num_remote_objects++] = obj;
+        report_remote_object_memory(obj->object_name, remote_object_memory(obj));
         if (obj->object_type == MASTER_TO_ALL_SLAVES) {
             triple_buffer_object_t* tb = (triple_buffer_object_t*)obj->buffer;
             triple_buffer_init(tb);
@@ -65,20 +238,45 @@ void add_remote_objects(remote_object_t** _remote_objects, uint32_t _num_remote_
                 triple_buffer_init(tb);
                 start += REMOTE_OBJECT_SIZE(obj->object_size);
             }
+            if (obj->object_type == SLAVE_TO_MASTER_DELTA) {
+                // Zero frames to the next snapshot, so that the first frame is one
+                memset(start, 0, DELTA_STATE_SIZE(obj->object_size, obj->element_size));
+            }
         }
     }
+    return true;
 }
 
 void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
     uint8_t id = data[size-1];
-    if (id < num_remote_objects) {
+    if (id == MESSAGE_CHANNEL_ID) {
+        message_channel_recv_frame(from, data, size - 1);
+    }
+    else if (id < num_remote_objects) {
         remote_object_t* obj = remote_objects[id];
-        if (obj->object_size == size - 1) {
+        if (obj->object_type == SLAVE_TO_MASTER_DELTA) {
+            if (from >= 1 && from <= NUM_SLAVES) {
+                delta_receiver_t* receiver = get_delta_receiver(obj, from - 1);
+                if (delta_decode(obj, receiver, data, size - 1)) {
+                    uint8_t* start = obj->buffer + LOCAL_OBJECT_SIZE(obj->object_size);
+                    start += (from - 1) * REMOTE_OBJECT_SIZE(obj->object_size);
+                    triple_buffer_object_t* tb = (triple_buffer_object_t*)start;
+                    void* ptr = triple_buffer_begin_write_internal(obj->object_size, tb);
+                    memcpy(ptr, receiver->object, obj->object_size);
+                    triple_buffer_end_write_internal(tb);
+                }
+            }
+        }
+        else if (obj->object_size == size - 1) {
             uint8_t* start;
             if (obj->object_type == MASTER_TO_ALL_SLAVES) {
                 start = obj->buffer + LOCAL_OBJECT_SIZE(obj->object_size);
             }
             else if(obj->object_type == SLAVE_TO_MASTER) {
+                if (from < 1 || from > NUM_SLAVES) {
+                    // A slave beyond SERIAL_LINK_NUM_SLAVES
+                    return;
+                }
                 start = obj->buffer + LOCAL_OBJECT_SIZE(obj->object_size);
                 start += (from - 1) * REMOTE_OBJECT_SIZE(obj->object_size);
             }
@@ -106,6 +304,17 @@ void update_transport(void) {
                 router_send_frame(dest, ptr, obj->object_size + 1);
             }
         }
+        else if (obj->object_type == SLAVE_TO_MASTER_DELTA) {
+            triple_buffer_object_t* tb = (triple_buffer_object_t*)obj->buffer;
+            uint8_t* ptr = (uint8_t*)triple_buffer_read_internal(obj->object_size + LOCAL_OBJECT_EXTRA, tb);
+            if (ptr) {
+                delta_sender_t* sender = get_delta_sender(obj);
+                uint8_t* frame = sender->last + obj->object_size;
+                uint16_t frame_size = delta_encode(obj, ptr, frame);
+                frame[frame_size] = i;
+                router_send_frame(0, frame, frame_size + 1);
+            }
+        }
         else {
             uint8_t* start = obj->buffer;
             unsigned int j;
@@ -25,11 +25,41 @@ SOFTWARE.
 #ifndef SERIAL_LINK_TRANSPORT_H
 #define SERIAL_LINK_TRANSPORT_H
 
+#include <stdbool.h>
 #include "serial_link/protocol/triple_buffered_object.h"
+#include "serial_link/protocol/frame_validator.h"
 #include "serial_link/system/serial_link.h"
 
-#define NUM_SLAVES 8
-#define LOCAL_OBJECT_EXTRA 16
+// Every object reserves buffers for each slave, so don't set this higher
+// than the number of boards that can be chained, minus the master
+#ifndef SERIAL_LINK_NUM_SLAVES
+#define SERIAL_LINK_NUM_SLAVES 8
+#endif
+
+#if SERIAL_LINK_NUM_SLAVES < 1 || SERIAL_LINK_NUM_SLAVES > 8
+#error "SERIAL_LINK_NUM_SLAVES must be between 1 and 8, the router addresses slaves with a bit each"
+#endif
+
+#ifndef SERIAL_LINK_MAX_REMOTE_OBJECTS
+#define SERIAL_LINK_MAX_REMOTE_OBJECTS 16
+#endif
+
+// Room after each local object for the object id, the router byte and the CRC
+#ifndef SERIAL_LINK_LOCAL_OBJECT_EXTRA
+#define SERIAL_LINK_LOCAL_OBJECT_EXTRA (2 + SERIAL_LINK_CRC_SIZE)
+#endif
+
+#define NUM_SLAVES SERIAL_LINK_NUM_SLAVES
+#define MAX_REMOTE_OBJECTS SERIAL_LINK_MAX_REMOTE_OBJECTS
+#define LOCAL_OBJECT_EXTRA SERIAL_LINK_LOCAL_OBJECT_EXTRA
+
+// A delta object sends a full snapshot after this many deltas and
+// heartbeats, so that a receiver that lost a frame gets back in sync even
+// while the object keeps changing. The first heartbeat after a delta is
+// always a snapshot.
+#ifndef SERIAL_LINK_DELTA_SNAPSHOT_INTERVAL
+#define SERIAL_LINK_DELTA_SNAPSHOT_INTERVAL 8
+#endif
 
 // master -> slave = 1 local(target all), 1 remote object
 // slave -> master = 1 local(target 0), multiple remote objects
@@ -38,11 +68,16 @@ typedef enum {
     MASTER_TO_ALL_SLAVES,
     MASTER_TO_SINGLE_SLAVE,
     SLAVE_TO_MASTER,
+    // slave -> master, only sending the elements that changed
+    SLAVE_TO_MASTER_DELTA,
 } remote_object_type;
 
 typedef struct {
+    const char* object_name;
     remote_object_type object_type;
     uint16_t object_size;
+    // The unit of change for delta objects
+    uint8_t element_size;
     uint8_t buffer[] __attribute__((aligned(4)));
 } remote_object_t;
 
@@ -51,18 +86,41 @@ typedef struct {
 #define LOCAL_OBJECT_SIZE(objectsize) \
     (sizeof(triple_buffer_object_t) + (objectsize + LOCAL_OBJECT_EXTRA) * 3)
 
-#define REMOTE_OBJECT_HELPER(name, type, num_local, num_remote) \
+// The frame of a delta object starts with a header byte holding the kind
+// of frame and a sequence number. A snapshot is followed by the whole
+// object, a delta by a bitmap of the changed elements and their values,
+// and a heartbeat by nothing.
+#define DELTA_BITMAP_SIZE(objectsize, elementsize) \
+    ((objectsize / elementsize + 7) / 8)
+#define DELTA_FRAME_SIZE(objectsize, elementsize) \
+    (1 + DELTA_BITMAP_SIZE(objectsize, elementsize) + objectsize)
+// The sequence number, frames until the next snapshot, whether a delta
+// was sent since, the last sent object and room to encode the next frame
+#define DELTA_SENDER_SIZE(objectsize, elementsize) \
+    (3 + objectsize + DELTA_FRAME_SIZE(objectsize, elementsize) + LOCAL_OBJECT_EXTRA)
+// The sequence number, whether it's in sync and the received object
+#define DELTA_RECEIVER_SIZE(objectsize) \
+    (2 + objectsize)
+#define DELTA_STATE_SIZE(objectsize, elementsize) \
+    (DELTA_SENDER_SIZE(objectsize, elementsize) + NUM_SLAVES * DELTA_RECEIVER_SIZE(objectsize))
+
+#define REMOTE_OBJECT_HELPER_EXTRA(name, type, num_local, num_remote, extra) \
 typedef struct { \
     remote_object_t object; \
     uint8_t buffer[ \
         num_remote * REMOTE_OBJECT_SIZE(sizeof(type)) + \
-        num_local * LOCAL_OBJECT_SIZE(sizeof(type))]; \
+        num_local * LOCAL_OBJECT_SIZE(sizeof(type)) + \
+        extra]; \
 } remote_object_##name##_t;
 
+#define REMOTE_OBJECT_HELPER(name, type, num_local, num_remote) \
+    REMOTE_OBJECT_HELPER_EXTRA(name, type, num_local, num_remote, 0)
+
 #define MASTER_TO_ALL_SLAVES_OBJECT(name, type) \
     REMOTE_OBJECT_HELPER(name, type, 1, 1) \
     remote_object_##name##_t remote_object_##name = { \
         .object = { \
+            .object_name = #name, \
             .object_type = MASTER_TO_ALL_SLAVES, \
             .object_size = sizeof(type), \
         } \
@@ -89,6 +147,7 @@ typedef struct { \
     REMOTE_OBJECT_HELPER(name, type, NUM_SLAVES, 1) \
     remote_object_##name##_t remote_object_##name = { \
         .object = { \
+            .object_name = #name, \
             .object_type = MASTER_TO_SINGLE_SLAVE, \
             .object_size = sizeof(type), \
         } \
@@ -115,14 +174,7 @@ typedef struct { \
         return triple_buffer_read_internal(obj->object_size, tb); \
     }
 
-#define SLAVE_TO_MASTER_OBJECT(name, type) \
-    REMOTE_OBJECT_HELPER(name, type, 1, NUM_SLAVES) \
-    remote_object_##name##_t remote_object_##name = { \
-        .object = { \
-            .object_type = SLAVE_TO_MASTER, \
-            .object_size = sizeof(type), \
-        } \
-    }; \
+#define SLAVE_TO_MASTER_ACCESSORS(name, type) \
     type* begin_write_##name(void) { \
         remote_object_t* obj = (remote_object_t*)&remote_object_##name; \
         triple_buffer_object_t* tb = (triple_buffer_object_t*)obj->buffer; \
@@ -142,9 +194,41 @@ typedef struct { \
         return triple_buffer_read_internal(obj->object_size, tb); \
     }
 
+#define SLAVE_TO_MASTER_OBJECT(name, type) \
+    REMOTE_OBJECT_HELPER(name, type, 1, NUM_SLAVES) \
+    remote_object_##name##_t remote_object_##name = { \
+        .object = { \
+            .object_name = #name, \
+            .object_type = SLAVE_TO_MASTER, \
+            .object_size = sizeof(type), \
+        } \
+    }; \
+    SLAVE_TO_MASTER_ACCESSORS(name, type)
+
+// Like SLAVE_TO_MASTER_OBJECT, but only the elements of the object that
+// changed since the last frame are sent. The type needs to be an array
+// of element_type, like the rows of a matrix.
+#define SLAVE_TO_MASTER_DELTA_OBJECT(name, type, element_type) \
+    REMOTE_OBJECT_HELPER_EXTRA(name, type, 1, NUM_SLAVES, \
+        DELTA_STATE_SIZE(sizeof(type), sizeof(element_type))) \
+    remote_object_##name##_t remote_object_##name = { \
+        .object = { \
+            .object_name = #name, \
+            .object_type = SLAVE_TO_MASTER_DELTA, \
+            .object_size = sizeof(type), \
+            .element_size = sizeof(element_type), \
+        } \
+    }; \
+    SLAVE_TO_MASTER_ACCESSORS(name, type)
+
 #define REMOTE_OBJECT(name) (remote_object_t*)&remote_object_##name
 
-void add_remote_objects(remote_object_t** remote_objects, uint32_t num_remote_objects);
+// Adds the objects to the end of the object table, reporting the memory
+// used by each through report_remote_object_memory. Returns false if they
+// didn't all fit into SERIAL_LINK_MAX_REMOTE_OBJECTS.
+bool add_remote_objects(remote_object_t** remote_objects, uint32_t num_remote_objects);
+// The size of the object including all its buffers, computed from the layout
+uint32_t remote_object_memory(remote_object_t* object);
 void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size);
 void update_transport(void);
 
@@ -28,12 +28,18 @@ SOFTWARE.
 #include "serial_link/protocol/byte_stuffer.h"
 #include "serial_link/protocol/transport.h"
 #include "serial_link/protocol/frame_router.h"
+#include "serial_link/protocol/message_channel.h"
+#include "serial_link/protocol/link_stats.h"
+#include "serial_link/protocol/dma_physical.h"
 #include "matrix.h"
 #include <stdbool.h>
 #include "print.h"
 #include "config.h"
 
 static event_source_t new_data_event;
+#ifdef SERIAL_LINK_DMA
+static event_source_t dma_rx_event;
+#endif
 static bool serial_link_connected;
 static bool is_master = false;
 
@@ -60,6 +66,16 @@ host_driver_t serial_driver = {
 #error "Serial link thread priority not set"
 #endif
 
+#ifdef SERIAL_LINK_DMA
+
+// Called by the keyboard from the idle line and DMA interrupts
+void serial_link_dma_rx_event_i(uint8_t link) {
+    (void)link;
+    chEvtBroadcastI(&dma_rx_event);
+}
+
+#else
+
 static SerialConfig config = {
     .sc_speed = SERIAL_LINK_BAUD
 };
@@ -67,19 +83,22 @@ static SerialConfig config = {
 //#define DEBUG_LINK_ERRORS
 
 static uint32_t read_from_serial(SerialDriver* driver, uint8_t link) {
-    const uint32_t buffer_size = 16;
+    const uint32_t buffer_size = 64;
     uint8_t buffer[buffer_size];
     uint32_t bytes_read = sdAsynchronousRead(driver, buffer, buffer_size);
-    uint8_t* current = buffer;
-    uint8_t* end = current + bytes_read;
-    while(current < end) {
-        byte_stuffer_recv_byte(link, *current);
-        current++;
-    }
+    byte_stuffer_recv_span(link, buffer, bytes_read);
     return bytes_read;
 }
 
-static void print_error(char* str, eventflags_t flags, SerialDriver* driver) {
+static void print_error(char* str, eventflags_t flags, SerialDriver* driver, uint8_t link) {
+    // The counters are always kept, printing every error is too noisy.
+    // The flags say which errors happened since the last call, not how many.
+    if (flags & SD_OVERRUN_ERROR) {
+        link_stats.links[link].overrun_events++;
+    }
+    if (flags & (SD_PARITY_ERROR | SD_FRAMING_ERROR | SD_NOISE_ERROR | SD_BREAK_DETECTED)) {
+        link_stats.links[link].line_error_events++;
+    }
 #ifdef DEBUG_LINK_ERRORS
     if (flags & SD_PARITY_ERROR) {
         print(str);
@@ -110,6 +129,8 @@ static void print_error(char* str, eventflags_t flags, SerialDriver* driver) {
 #endif
 }
 
+#endif
+
 bool is_serial_link_master(void) {
     return is_master;
 }
@@ -119,9 +140,13 @@ static THD_WORKING_AREA(serialThreadStack, 1024);
 static THD_FUNCTION(serialThread, arg) {
     (void)arg;
     event_listener_t new_data_listener;
+    chEvtRegister(&new_data_event, &new_data_listener, 0);
+#ifdef SERIAL_LINK_DMA
+    event_listener_t dma_rx_listener;
+    chEvtRegisterMask(&dma_rx_event, &dma_rx_listener, EVENT_MASK(1));
+#else
     event_listener_t sd1_listener;
     event_listener_t sd2_listener;
-    chEvtRegister(&new_data_event, &new_data_listener, 0);
     eventflags_t events = CHN_INPUT_AVAILABLE
             | SD_PARITY_ERROR | SD_FRAMING_ERROR | SD_OVERRUN_ERROR | SD_NOISE_ERROR | SD_BREAK_DETECTED;
     chEvtRegisterMaskWithFlags(chnGetEventSource(&SD1),
@@ -132,43 +157,76 @@ static THD_FUNCTION(serialThread, arg) {
         &sd2_listener,
         EVENT_MASK(2),
         events);
+#endif
     bool need_wait = false;
+    uint16_t wait_ms = 1000;
     while(true) {
-        eventflags_t flags1 = 0;
-        eventflags_t flags2 = 0;
         if (need_wait) {
-            eventmask_t mask = chEvtWaitAnyTimeout(ALL_EVENTS, MS2ST(1000));
+#ifdef SERIAL_LINK_DMA
+            chEvtWaitAnyTimeout(ALL_EVENTS, MS2ST(wait_ms));
+#else
+            eventmask_t mask = chEvtWaitAnyTimeout(ALL_EVENTS, MS2ST(wait_ms));
             if (mask & EVENT_MASK(1)) {
-                flags1 = chEvtGetAndClearFlags(&sd1_listener);
-                print_error("DOWNLINK", flags1, &SD1);
+                eventflags_t flags1 = chEvtGetAndClearFlags(&sd1_listener);
+                print_error("DOWNLINK", flags1, &SD1, DOWN_LINK);
             }
             if (mask & EVENT_MASK(2)) {
-                flags2 = chEvtGetAndClearFlags(&sd2_listener);
-                print_error("UPLINK", flags2, &SD2);
+                eventflags_t flags2 = chEvtGetAndClearFlags(&sd2_listener);
+                print_error("UPLINK", flags2, &SD2, UP_LINK);
             }
+#endif
         }
 
         // Always stay as master, even if the USB goes into sleep mode
         is_master |= usbGetDriverStateI(&USBD1) == USB_ACTIVE;
         router_set_master(is_master);
 
+#ifdef SERIAL_LINK_DMA
+        need_wait = dma_physical_recv() == 0;
+#else
         need_wait = true;
         need_wait &= read_from_serial(&SD2, UP_LINK) == 0;
         need_wait &= read_from_serial(&SD1, DOWN_LINK) == 0;
+#endif
         update_transport();
+        // Wake up in time for the message retransmissions
+        wait_ms = update_message_channel(ST2MS(chVTGetSystemTimeX()));
+        if (wait_ms > 1000) {
+            wait_ms = 1000;
+        }
     }
 }
 
 void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+#ifdef SERIAL_LINK_DMA
+    // A dropped frame is counted, and lost like one with a bad CRC
+    dma_physical_send(link, data, size);
+#else
     if (link == DOWN_LINK) {
         sdWrite(&SD1, data, size);
     }
     else {
         sdWrite(&SD2, data, size);
     }
+#endif
 }
 
-static systime_t last_update = 0;
+// How often the matrix is sent on top of its changes. Unchanged matrices
+// only cost a one byte heartbeat, and every
+// SERIAL_LINK_DELTA_SNAPSHOT_INTERVAL frames a full snapshot. Changes
+// don't put the heartbeat off, and the first one after a change is a
+// snapshot, so a lost change leaves the master stale for at most this long.
+#ifndef SERIAL_LINK_HEARTBEAT_US
+#define SERIAL_LINK_HEARTBEAT_US 10000
+#endif
+
+// How often the slaves send their link statistics to the master
+#ifndef SERIAL_LINK_STATS_INTERVAL_MS
+#define SERIAL_LINK_STATS_INTERVAL_MS 1000
+#endif
+
+static systime_t last_heartbeat = 0;
+static systime_t last_stats_update = 0;
 
 typedef struct {
     matrix_row_t rows[MATRIX_ROWS];
@@ -176,12 +234,18 @@ typedef struct {
 
 static matrix_object_t last_matrix = {};
 
-SLAVE_TO_MASTER_OBJECT(keyboard_matrix, matrix_object_t);
+SLAVE_TO_MASTER_DELTA_OBJECT(keyboard_matrix, matrix_object_t, matrix_row_t);
 MASTER_TO_ALL_SLAVES_OBJECT(serial_link_connected, bool);
+SLAVE_TO_MASTER_OBJECT(slave_link_stats, link_stats_t);
+
+// The latest statistics from each slave, the object is only readable
+// once after each write
+static link_stats_t slave_stats[NUM_SLAVES];
 
 static remote_object_t* remote_objects[] = {
     REMOTE_OBJECT(serial_link_connected),
     REMOTE_OBJECT(keyboard_matrix),
+    REMOTE_OBJECT(slave_link_stats),
 };
 
 void init_serial_link(void) {
@@ -189,9 +253,15 @@ void init_serial_link(void) {
     init_serial_link_hal();
     add_remote_objects(remote_objects, sizeof(remote_objects)/sizeof(remote_object_t*));
     init_byte_stuffer();
+    init_message_channel();
+    chEvtObjectInit(&new_data_event);
+#ifdef SERIAL_LINK_DMA
+    chEvtObjectInit(&dma_rx_event);
+    init_dma_physical();
+#else
     sdStart(&SD1, &config);
     sdStart(&SD2, &config);
-    chEvtObjectInit(&new_data_event);
+#endif
     (void)chThdCreateStatic(serialThreadStack, sizeof(serialThreadStack),
                               SERIAL_LINK_THREAD_PRIORITY, serialThread, NULL);
 }
@@ -211,9 +281,11 @@ void serial_link_update(void) {
     }
 
     systime_t current_time = chVTGetSystemTimeX();
-    systime_t delta = current_time - last_update;
-    if (changed || delta > US2ST(1000)) {
-        last_update = current_time;
+    bool heartbeat = current_time - last_heartbeat > US2ST(SERIAL_LINK_HEARTBEAT_US);
+    if (changed || heartbeat) {
+        if (heartbeat) {
+            last_heartbeat = current_time;
+        }
         last_matrix = matrix;
         matrix_object_t* m = begin_write_keyboard_matrix();
         for(uint8_t i=0;i<MATRIX_ROWS;i++) {
@@ -224,6 +296,21 @@ void serial_link_update(void) {
         end_write_serial_link_connected();
     }
 
+    if (current_time - last_stats_update > MS2ST(SERIAL_LINK_STATS_INTERVAL_MS)) {
+        last_stats_update = current_time;
+        link_stats_t* stats = begin_write_slave_link_stats();
+        serial_link_lock();
+        *stats = link_stats;
+        serial_link_unlock();
+        end_write_slave_link_stats();
+    }
+    for (uint8_t i = 0; i < NUM_SLAVES; i++) {
+        link_stats_t* stats = read_slave_link_stats(i);
+        if (stats) {
+            slave_stats[i] = *stats;
+        }
+    }
+
     matrix_object_t* m = read_keyboard_matrix(0);
     if (m) {
         matrix_set_remote(m->rows, 0);
@@ -234,6 +321,52 @@ void signal_data_written(void) {
     chEvtBroadcast(&new_data_event);
 }
 
+// Keyboards that send messages over the link implement this
+__attribute__((weak))
+void message_channel_received(uint8_t peer, const uint8_t* data, uint8_t size) {
+    (void)peer;
+    (void)data;
+    (void)size;
+}
+
+void report_remote_object_memory(const char* name, uint32_t size) {
+    xprintf("serial link object %s: %lu bytes\n", name, size);
+}
+
+static void print_link_counters(const char* name, const link_counters_t* counters) {
+    xprintf("  %s frames %lu crc %lu cobs %lu overrun events %lu line error events %lu tx drops %lu\n", name,
+        counters->frames, counters->crc_errors, counters->cobs_resets,
+        counters->overrun_events, counters->line_error_events, counters->tx_drops);
+}
+
+static void print_link_stats(const link_stats_t* stats) {
+    print_link_counters("up", &stats->links[UP_LINK]);
+    print_link_counters("down", &stats->links[DOWN_LINK]);
+    // Only the message channel feeds these, they stay at 0 on a link that
+    // carries nothing but the shared objects
+    if (stats->rtt_max_ms == 0 && stats->retransmits == 0) {
+        print("  retransmits, rtt: no message channel traffic\n");
+        return;
+    }
+    xprintf("  message channel retransmits %lu rtt %u ms max %u ms\n",
+        stats->retransmits, stats->rtt_ms, stats->rtt_max_ms);
+}
+
+void serial_link_print_stats(void) {
+    link_stats_t stats;
+    serial_link_lock();
+    stats = link_stats;
+    serial_link_unlock();
+    print("serial link\n");
+    print_link_stats(&stats);
+    if (is_master) {
+        for (uint8_t i = 0; i < NUM_SLAVES; i++) {
+            xprintf("serial link slave %u\n", i + 1);
+            print_link_stats(&slave_stats[i]);
+        }
+    }
+}
+
 bool is_serial_link_connected(void) {
     return serial_link_connected;
 }
@@ -34,6 +34,8 @@ bool is_serial_link_connected(void);
 bool is_serial_link_master(void);
 host_driver_t* get_serial_link_driver(void);
 void serial_link_update(void);
+// Prints the link counters, and on the master the ones from the slaves
+void serial_link_print_stats(void);
 
 #if defined(PROTOCOL_CHIBIOS)
 #include "ch.h"
@@ -47,16 +49,18 @@ static inline void serial_link_unlock(void) {
 }
 
 void signal_data_written(void);
+void report_remote_object_memory(const char* name, uint32_t size);
 
 #else
 
-inline void serial_link_lock(void) {
+static inline void serial_link_lock(void) {
 }
 
-inline void serial_link_unlock(void) {
+static inline void serial_link_unlock(void) {
 }
 
 void signal_data_written(void);
+void report_remote_object_memory(const char* name, uint32_t size);
 
 #endif
 
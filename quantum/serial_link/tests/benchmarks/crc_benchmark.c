@@ -0,0 +1,85 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Frame check throughput of the selected SERIAL_LINK_CRC_SIZE/SERIAL_LINK_CRC32
+// back end on the host, for comparing the back ends against each other.
+// Built and run once per back end by "make benchmark".
+#include <stdio.h>
+#include <time.h>
+#include "serial_link/protocol/frame_validator.c"
+#include "serial_link/protocol/link_stats.c"
+
+void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size) {
+}
+
+void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char* name, uint16_t frame_size) {
+    static uint8_t data[1024 + SERIAL_LINK_CRC_SIZE];
+    for (unsigned i = 0; i < sizeof(data); i++) {
+        data[i] = i * 7 + 3;
+    }
+    volatile frame_crc_t sink = 0;
+    uint32_t bytes = 0;
+    uint32_t frames = 0;
+    double start = now_s();
+    double elapsed;
+    do {
+        for (unsigned i = 0; i < 1000; i++) {
+            data[0] = i;
+            sink ^= frame_crc(data, frame_size);
+        }
+        frames += 1000;
+        bytes += 1000u * frame_size;
+        elapsed = now_s() - start;
+    } while (elapsed < 0.2);
+    (void)sink;
+    printf("%-10s %4u byte frames: %8.1f MB/s %7.1f ns/frame\n", name, frame_size,
+        bytes / elapsed / 1e6, elapsed * 1e9 / frames);
+}
+
+int main(void) {
+#if SERIAL_LINK_CRC_SIZE == 4 && SERIAL_LINK_CRC32 == CRC32_BYTEWISE
+    const char* name = "crc32";
+#elif SERIAL_LINK_CRC_SIZE == 4 && SERIAL_LINK_CRC32 == CRC32_SLICE_BY_4
+    const char* name = "crc32/4";
+#elif SERIAL_LINK_CRC_SIZE == 4 && SERIAL_LINK_CRC32 == CRC32_SLICE_BY_8
+    const char* name = "crc32/8";
+#elif SERIAL_LINK_CRC_SIZE == 2
+    const char* name = "crc16";
+#else
+    const char* name = "crc8";
+#endif
+    run(name, 8);
+    run(name, 64);
+    run(name, 1024);
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cgreen/cgreen.h>
+#include <cgreen/mocks.h>
+#include <stdlib.h>
+#include "serial_link/protocol/byte_stuffer.c"
+#include "serial_link/protocol/frame_validator.c"
+#include "serial_link/protocol/link_stats.c"
+
+// Encodes frames into a stream and decodes it with the span decoder, the
+// way the serial thread hands over what each read returned.
+
+static uint8_t stream[8192];
+static uint16_t stream_size;
+
+static uint8_t received[16][MAX_FRAME_SIZE];
+static uint16_t received_size[16];
+static uint16_t num_received;
+
+void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size) {
+    memcpy(received[num_received], data, size);
+    received_size[num_received] = size;
+    num_received++;
+}
+
+void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+    memcpy(stream + stream_size, data, size);
+    stream_size += size;
+}
+
+// Frames are sent with room for the CRC after the data
+static void send(uint8_t* data, uint16_t size) {
+    static uint8_t frame[MAX_FRAME_SIZE];
+    memcpy(frame, data, size);
+    validator_send_frame(0, frame, size);
+}
+
+Describe(ByteStufferSpan);
+BeforeEach(ByteStufferSpan) {
+    init_byte_stuffer();
+    stream_size = 0;
+    num_received = 0;
+    srand(7);
+}
+AfterEach(ByteStufferSpan) {}
+
+Ensure(ByteStufferSpan, receives_a_frame_in_one_span) {
+    uint8_t data[] = {1, 0, 2, 3, 0, 0, 4};
+    send(data, sizeof(data));
+    assert_that(stream_size, is_equal_to(sizeof(data) + 4 + 2));
+    byte_stuffer_recv_span(0, stream, stream_size);
+    assert_that(num_received, is_equal_to(1));
+    assert_that(received_size[0], is_equal_to(sizeof(data)));
+    assert_that(received[0], is_equal_to_contents_of(data, sizeof(data)));
+}
+
+Ensure(ByteStufferSpan, receives_nothing_from_an_empty_span) {
+    byte_stuffer_recv_span(0, stream, 0);
+    assert_that(num_received, is_equal_to(0));
+}
+
+Ensure(ByteStufferSpan, receives_frames_split_at_every_position) {
+    uint8_t data[30] = {0, 1, 2, 3, 0, 5, 6, 7, 8, 0, 0, 11};
+    send(data, sizeof(data));
+    for (uint16_t split = 0; split <= stream_size; split++) {
+        num_received = 0;
+        byte_stuffer_recv_span(0, stream, split);
+        byte_stuffer_recv_span(0, stream + split, stream_size - split);
+        assert_that(num_received, is_equal_to(1));
+        assert_that(received[0], is_equal_to_contents_of(data, sizeof(data)));
+    }
+}
+
+Ensure(ByteStufferSpan, drops_a_corrupted_frame_and_receives_the_next) {
+    uint8_t data[] = {1, 2, 3, 4, 5};
+    send(data, sizeof(data));
+    stream[3] ^= 0x10;
+    send(data, sizeof(data));
+    byte_stuffer_recv_span(0, stream, stream_size);
+    assert_that(num_received, is_equal_to(1));
+    assert_that(received[0], is_equal_to_contents_of(data, sizeof(data)));
+}
+
+Ensure(ByteStufferSpan, span_decoder_matches_byte_decoder_on_random_streams) {
+    uint16_t total_received = 0;
+    for (int round = 0; round < 50; round++) {
+        // Valid frames with zeroes and long non-zero runs, mixed with
+        // noise and single corrupted bytes
+        stream_size = 0;
+        for (int i = 0; i < 8; i++) {
+            uint8_t data[600];
+            uint16_t size = 1 + rand() % (i == 0 ? 600 : 80);
+            for (uint16_t j = 0; j < size; j++) {
+                uint8_t r = rand();
+                data[j] = r < 30 ? 0 : r;
+            }
+            if (rand() % 4 == 0) {
+                stream[stream_size++] = rand();
+            }
+            uint16_t start = stream_size;
+            send(data, size);
+            if (rand() % 4 == 0) {
+                stream[start + rand() % (stream_size - start)] ^= 1 << (rand() % 8);
+            }
+        }
+        uint16_t size = stream_size;
+
+        init_byte_stuffer();
+        num_received = 0;
+        for (uint16_t i = 0; i < size; i++) {
+            byte_stuffer_recv_byte(0, stream[i]);
+        }
+        uint16_t byte_received = num_received;
+        static uint8_t byte_frames[16][MAX_FRAME_SIZE];
+        static uint16_t byte_sizes[16];
+        memcpy(byte_frames, received, sizeof(received));
+        memcpy(byte_sizes, received_size, sizeof(received_size));
+
+        init_byte_stuffer();
+        num_received = 0;
+        uint16_t pos = 0;
+        while (pos < size) {
+            uint16_t span = rand() % 300;
+            if (span > size - pos) {
+                span = size - pos;
+            }
+            byte_stuffer_recv_span(0, stream + pos, span);
+            pos += span;
+        }
+        assert_that(num_received, is_equal_to(byte_received));
+        for (uint16_t i = 0; i < num_received; i++) {
+            assert_that(received_size[i], is_equal_to(byte_sizes[i]));
+            assert_that(received[i], is_equal_to_contents_of(byte_frames[i], byte_sizes[i]));
+        }
+        total_received += num_received;
+    }
+    assert_that(total_received, is_greater_than(200));
+}
@@ -26,16 +26,20 @@ SOFTWARE.
 #include <cgreen/mocks.h>
 #include "serial_link/protocol/byte_stuffer.h"
 #include "serial_link/protocol/byte_stuffer.c"
+#include "serial_link/protocol/link_stats.c"
 #include "serial_link/protocol/frame_validator.h"
 #include "serial_link/protocol/physical.h"
 
 static uint8_t sent_data[MAX_FRAME_SIZE*2];
 static uint16_t sent_data_size;
+static uint16_t send_data_calls;
 
 Describe(ByteStuffer);
 BeforeEach(ByteStuffer) {
     init_byte_stuffer();
+    memset(&link_stats, 0, sizeof(link_stats));
     sent_data_size = 0;
+    send_data_calls = 0;
 }
 AfterEach(ByteStuffer) {}
 
@@ -46,6 +50,7 @@ void validator_recv_frame(uint8_t link, uint8_t* data, uint16_t size) {
 void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
     memcpy(sent_data + sent_data_size, data, size);
     sent_data_size += size;
+    send_data_calls++;
 }
 
 Ensure(ByteStuffer, receives_no_frame_for_a_single_zero_byte) {
@@ -136,6 +141,7 @@ Ensure(ByteStuffer, receives_two_valid_frames) {
     byte_stuffer_recv_byte(1, 2);
     byte_stuffer_recv_byte(1, 3);
     byte_stuffer_recv_byte(1, 0);
+    assert_that(link_stats.links[1].cobs_resets, is_equal_to(0));
 }
 
 Ensure(ByteStuffer, receives_valid_frame_after_unexpected_zero) {
@@ -151,6 +157,8 @@ Ensure(ByteStuffer, receives_valid_frame_after_unexpected_zero) {
     byte_stuffer_recv_byte(1, 5);
     byte_stuffer_recv_byte(1, 7);
     byte_stuffer_recv_byte(1, 0);
+    assert_that(link_stats.links[1].cobs_resets, is_equal_to(1));
+    assert_that(link_stats.links[0].cobs_resets, is_equal_to(0));
 }
 
 Ensure(ByteStuffer, receives_valid_frame_after_unexpected_non_zero) {
@@ -167,6 +175,7 @@ Ensure(ByteStuffer, receives_valid_frame_after_unexpected_non_zero) {
     byte_stuffer_recv_byte(0, 5);
     byte_stuffer_recv_byte(0, 7);
     byte_stuffer_recv_byte(0, 0);
+    assert_that(link_stats.links[0].cobs_resets, is_equal_to(1));
 }
 
 Ensure(ByteStuffer, receives_a_valid_frame_with_over254_non_zeroes_and_then_end_of_frame) {
@@ -301,17 +310,62 @@ Ensure(ByteStuffer, received_frame_is_aborted_when_its_too_long) {
     byte_stuffer_recv_byte(0, 2);
     byte_stuffer_recv_byte(0, 1);
     byte_stuffer_recv_byte(0, 0);
+    assert_that(link_stats.links[0].cobs_resets, is_equal_to(1));
 }
 
 Ensure(ByteStuffer, does_nothing_when_sending_zero_size_frame) {
-    assert_that(sent_data_size, is_equal_to(0));
     byte_stuffer_send_frame(0, NULL, 0);
+    assert_that(sent_data_size, is_equal_to(0));
+    assert_that(send_data_calls, is_equal_to(0));
+}
+
+Ensure(ByteStuffer, does_nothing_when_sending_a_frame_thats_too_long) {
+    static uint8_t data[MAX_FRAME_SIZE + 1];
+    byte_stuffer_send_frame(0, data, sizeof(data));
+    assert_that(send_data_calls, is_equal_to(0));
+}
+
+Ensure(ByteStuffer, sends_a_frame_with_zeroes_in_a_single_write) {
+    uint8_t data[] = {0, 0x55, 0, 0, 7, 8};
+    byte_stuffer_send_frame(0, data, sizeof(data));
+    assert_that(send_data_calls, is_equal_to(1));
+    assert_that(sent_data_size, is_equal_to(sizeof(data) + 2));
+}
+
+Ensure(ByteStuffer, sends_a_maximum_size_non_zero_frame_in_a_single_write) {
+    uint8_t data[MAX_FRAME_SIZE];
+    int i;
+    for(i=0;i<MAX_FRAME_SIZE;i++) {
+        data[i] = i % 255 + 1;
+    }
+    byte_stuffer_send_frame(0, data, MAX_FRAME_SIZE);
+    // Five code bytes and the terminator, the worst case overhead
+    assert_that(send_data_calls, is_equal_to(1));
+    assert_that(sent_data_size, is_equal_to(MAX_FRAME_SIZE + 6));
+    assert_that(sent_data_size, is_equal_to(MAX_ENCODED_FRAME_SIZE));
+}
+
+Ensure(ByteStuffer, sends_and_receives_full_roundtrip_maximum_size_non_zero_frame) {
+    uint8_t original_data[MAX_FRAME_SIZE];
+    int i;
+    for(i=0;i<MAX_FRAME_SIZE;i++) {
+        original_data[i] = i % 255 + 1;
+    }
+    byte_stuffer_send_frame(0, original_data, sizeof(original_data));
+    expect(validator_recv_frame,
+        when(size, is_equal_to(sizeof(original_data))),
+        when(data, is_equal_to_contents_of(original_data, sizeof(original_data)))
+    );
+    for(i=0;i<sent_data_size;i++) {
+       byte_stuffer_recv_byte(1, sent_data[i]);
+    }
 }
 
 Ensure(ByteStuffer, send_one_byte_frame) {
     uint8_t data[] = {5};
     byte_stuffer_send_frame(1, data, 1);
     uint8_t expected[] = {2, 5, 0};
+    assert_that(send_data_calls, is_equal_to(1));
     assert_that(sent_data_size, is_equal_to(sizeof(expected)));
     assert_that(sent_data, is_equal_to_contents_of(expected, sizeof(expected)));
 }
@@ -320,6 +374,7 @@ Ensure(ByteStuffer, sends_two_byte_frame) {
     uint8_t data[] = {5, 0x77};
     byte_stuffer_send_frame(0, data, 2);
     uint8_t expected[] = {3, 5, 0x77, 0};
+    assert_that(send_data_calls, is_equal_to(1));
     assert_that(sent_data_size, is_equal_to(sizeof(expected)));
     assert_that(sent_data, is_equal_to_contents_of(expected, sizeof(expected)));
 }
@@ -328,6 +383,7 @@ Ensure(ByteStuffer, sends_one_byte_frame_with_zero) {
     uint8_t data[] = {0};
     byte_stuffer_send_frame(0, data, 1);
     uint8_t expected[] = {1, 1, 0};
+    assert_that(send_data_calls, is_equal_to(1));
     assert_that(sent_data_size, is_equal_to(sizeof(expected)));
     assert_that(sent_data, is_equal_to_contents_of(expected, sizeof(expected)));
 }
@@ -336,6 +392,7 @@ Ensure(ByteStuffer, sends_two_byte_frame_starting_with_zero) {
     uint8_t data[] = {0, 9};
     byte_stuffer_send_frame(1, data, 2);
     uint8_t expected[] = {1, 2, 9, 0};
+    assert_that(send_data_calls, is_equal_to(1));
     assert_that(sent_data_size, is_equal_to(sizeof(expected)));
     assert_that(sent_data, is_equal_to_contents_of(expected, sizeof(expected)));
 }
@@ -344,6 +401,7 @@ Ensure(ByteStuffer, sends_two_byte_frame_starting_with_non_zero) {
     uint8_t data[] = {9, 0};
     byte_stuffer_send_frame(1, data, 2);
     uint8_t expected[] = {2, 9, 1, 0};
+    assert_that(send_data_calls, is_equal_to(1));
     assert_that(sent_data_size, is_equal_to(sizeof(expected)));
     assert_that(sent_data, is_equal_to_contents_of(expected, sizeof(expected)));
 }
@@ -352,6 +410,7 @@ Ensure(ByteStuffer, sends_three_byte_frame_zero_in_the_middle) {
     uint8_t data[] = {9, 0, 0x68};
     byte_stuffer_send_frame(0, data, 3);
     uint8_t expected[] = {2, 9, 2, 0x68, 0};
+    assert_that(send_data_calls, is_equal_to(1));
     assert_that(sent_data_size, is_equal_to(sizeof(expected)));
     assert_that(sent_data, is_equal_to_contents_of(expected, sizeof(expected)));
 }
@@ -360,6 +419,7 @@ Ensure(ByteStuffer, sends_three_byte_frame_data_in_the_middle) {
     uint8_t data[] = {0, 0x55, 0};
     byte_stuffer_send_frame(0, data, 3);
     uint8_t expected[] = {1, 2, 0x55, 1, 0};
+    assert_that(send_data_calls, is_equal_to(1));
     assert_that(sent_data_size, is_equal_to(sizeof(expected)));
     assert_that(sent_data, is_equal_to_contents_of(expected, sizeof(expected)));
 }
@@ -368,6 +428,7 @@ Ensure(ByteStuffer, sends_three_byte_frame_with_all_zeroes) {
     uint8_t data[] = {0, 0, 0};
     byte_stuffer_send_frame(0, data, 3);
     uint8_t expected[] = {1, 1, 1, 1, 0};
+    assert_that(send_data_calls, is_equal_to(1));
     assert_that(sent_data_size, is_equal_to(sizeof(expected)));
     assert_that(sent_data, is_equal_to_contents_of(expected, sizeof(expected)));
 }
@@ -385,6 +446,7 @@ Ensure(ByteStuffer, sends_frame_with_254_non_zeroes) {
         expected[i] = i;
     }
     expected[255] = 0;
+    assert_that(send_data_calls, is_equal_to(1));
     assert_that(sent_data_size, is_equal_to(sizeof(expected)));
     assert_that(sent_data, is_equal_to_contents_of(expected, sizeof(expected)));
 }
@@ -404,6 +466,7 @@ Ensure(ByteStuffer, sends_frame_with_255_non_zeroes) {
     expected[255] = 2;
     expected[256] = 255;
     expected[257] = 0;
+    assert_that(send_data_calls, is_equal_to(1));
     assert_that(sent_data_size, is_equal_to(sizeof(expected)));
     assert_that(sent_data, is_equal_to_contents_of(expected, sizeof(expected)));
 }
@@ -424,6 +487,7 @@ Ensure(ByteStuffer, sends_frame_with_254_non_zeroes_followed_by_zero) {
     expected[255] = 1;
     expected[256] = 1;
     expected[257] = 0;
+    assert_that(send_data_calls, is_equal_to(1));
     assert_that(sent_data_size, is_equal_to(sizeof(expected)));
     assert_that(sent_data, is_equal_to_contents_of(expected, sizeof(expected)));
 }
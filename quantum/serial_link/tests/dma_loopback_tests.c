@@ -0,0 +1,288 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cgreen/cgreen.h>
+#include <cgreen/mocks.h>
+#include <stdlib.h>
+// Small buffers, so that the frames wrap around them often
+#define SERIAL_LINK_DMA_RX_SIZE 64
+#define SERIAL_LINK_DMA_TX_SIZE 48
+#include "serial_link/protocol/dma_physical.c"
+#include "serial_link/protocol/byte_stuffer.c"
+#include "serial_link/protocol/frame_validator.c"
+#include "serial_link/protocol/link_stats.c"
+
+// The keyboard side of dma_physical.h done in software. A loopback cable
+// connects the transmitter of each link to the receiver of the other, and
+// the bytes of a running transfer move over it when the test says so.
+
+static uint8_t* rx_buffer[NUM_LINKS];
+static uint16_t rx_size[NUM_LINKS];
+static uint16_t rx_pos[NUM_LINKS];
+static uint16_t rx_events[NUM_LINKS];
+// Report the end of the buffer instead of 0 after a wrap, like some DMAs
+static bool rx_pos_at_end;
+
+static const uint8_t* tx_data[NUM_LINKS];
+static uint16_t tx_size[NUM_LINKS];
+static uint16_t tx_sent[NUM_LINKS];
+static uint16_t tx_transfers;
+
+void serial_link_dma_init(uint8_t link, uint8_t* buffer, uint16_t size) {
+    rx_buffer[link] = buffer;
+    rx_size[link] = size;
+    rx_pos[link] = 0;
+}
+
+uint16_t serial_link_dma_rx_position(uint8_t link) {
+    if (rx_pos[link] == 0 && rx_pos_at_end) {
+        return rx_size[link];
+    }
+    return rx_pos[link];
+}
+
+void serial_link_dma_start_tx_i(uint8_t link, const uint8_t* data, uint16_t size) {
+    assert_that(tx_size[link], is_equal_to(0));
+    assert_that(size, is_greater_than(0));
+    tx_data[link] = data;
+    tx_size[link] = size;
+    tx_sent[link] = 0;
+    tx_transfers++;
+}
+
+void serial_link_dma_rx_event_i(uint8_t link) {
+    rx_events[link]++;
+}
+
+// Moves up to size bytes of the running transfer of the link to the other
+// end, and raises the idle line interrupt there
+static void wire(uint8_t link, uint16_t size) {
+    uint8_t peer = link ^ 1;
+    while (size > 0 && tx_sent[link] < tx_size[link]) {
+        rx_buffer[peer][rx_pos[peer]] = tx_data[link][tx_sent[link]++];
+        rx_pos[peer] = (rx_pos[peer] + 1) % rx_size[peer];
+        size--;
+    }
+    serial_link_dma_rx_event_i(peer);
+    if (tx_size[link] > 0 && tx_sent[link] == tx_size[link]) {
+        tx_size[link] = 0;
+        dma_physical_tx_done_i(link);
+    }
+}
+
+static void wire_all(void) {
+    while (tx_size[UP_LINK] > 0 || tx_size[DOWN_LINK] > 0) {
+        wire(UP_LINK, 0xFFFF);
+        wire(DOWN_LINK, 0xFFFF);
+    }
+}
+
+void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+    dma_physical_send(link, data, size);
+}
+
+static uint8_t received[32][MAX_FRAME_SIZE];
+static uint16_t received_size[32];
+static uint8_t received_link[32];
+static uint16_t num_received;
+
+void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size) {
+    memcpy(received[num_received], data, size);
+    received_size[num_received] = size;
+    received_link[num_received] = link;
+    num_received++;
+}
+
+// Frames are sent with room for the CRC after the data
+static void send(uint8_t link, const uint8_t* data, uint16_t size) {
+    static uint8_t frame[MAX_FRAME_SIZE];
+    memcpy(frame, data, size);
+    validator_send_frame(link, frame, size);
+}
+
+static void fill(uint8_t* data, uint16_t size, uint8_t seed) {
+    uint16_t i;
+    for (i=0;i<size;i++) {
+        data[i] = (i + seed) % 5 == 0 ? 0 : i * 7 + seed;
+    }
+}
+
+Describe(DMALoopback);
+BeforeEach(DMALoopback) {
+    memset(&link_stats, 0, sizeof(link_stats));
+    memset(tx_size, 0, sizeof(tx_size));
+    memset(rx_events, 0, sizeof(rx_events));
+    rx_pos_at_end = false;
+    tx_transfers = 0;
+    num_received = 0;
+    init_byte_stuffer();
+    init_dma_physical();
+    srand(3);
+}
+AfterEach(DMALoopback) {}
+
+Ensure(DMALoopback, sends_a_frame_from_the_up_link_to_the_down_link) {
+    uint8_t data[] = {1, 0, 2, 3, 0, 0, 4};
+    send(UP_LINK, data, sizeof(data));
+    assert_that(tx_transfers, is_equal_to(1));
+    assert_that(dma_physical_recv(), is_equal_to(0));
+    wire_all();
+    assert_that(rx_events[DOWN_LINK], is_greater_than(0));
+    assert_that(dma_physical_recv(), is_equal_to(sizeof(data) + 4 + 2));
+    assert_that(num_received, is_equal_to(1));
+    assert_that(received_link[0], is_equal_to(DOWN_LINK));
+    assert_that(received_size[0], is_equal_to(sizeof(data)));
+    assert_that(received[0], is_equal_to_contents_of(data, sizeof(data)));
+    assert_that(dma_physical_recv(), is_equal_to(0));
+}
+
+Ensure(DMALoopback, queues_frames_while_a_transfer_is_running) {
+    uint8_t data[3][8];
+    uint8_t i;
+    for (i=0;i<3;i++) {
+        fill(data[i], sizeof(data[i]), i);
+        send(UP_LINK, data[i], sizeof(data[i]));
+    }
+    // The first frame is on its way, the others wait for it in one piece
+    assert_that(tx_transfers, is_equal_to(1));
+    wire_all();
+    assert_that(tx_transfers, is_equal_to(2));
+    dma_physical_recv();
+    assert_that(num_received, is_equal_to(3));
+    for (i=0;i<3;i++) {
+        assert_that(received[i], is_equal_to_contents_of(data[i], sizeof(data[i])));
+    }
+}
+
+Ensure(DMALoopback, wraps_around_both_buffers) {
+    uint16_t total = 0;
+    uint8_t i;
+    for (i=0;i<30;i++) {
+        uint8_t data[20];
+        uint16_t size = 1 + i % sizeof(data);
+        fill(data, size, i);
+        send(UP_LINK, data, size);
+        wire_all();
+        total += dma_physical_recv();
+        assert_that(num_received, is_equal_to(1));
+        assert_that(received_size[0], is_equal_to(size));
+        assert_that(received[0], is_equal_to_contents_of(data, size));
+        num_received = 0;
+    }
+    assert_that(total, is_greater_than(4 * SERIAL_LINK_DMA_RX_SIZE));
+    // Split at the end of the transmit buffer every now and then
+    assert_that(tx_transfers, is_greater_than(30));
+}
+
+Ensure(DMALoopback, decodes_frames_split_by_idle_line_interrupts) {
+    uint8_t data[4][10];
+    uint8_t sent = 0;
+    uint8_t round;
+    for (round=0;round<20;round++) {
+        uint8_t i;
+        for (i=0;i<4;i++) {
+            fill(data[i], sizeof(data[i]), round * 4 + i);
+        }
+        send(UP_LINK, data[0], sizeof(data[0]));
+        send(UP_LINK, data[1], sizeof(data[1]));
+        // Arrives a few bytes at a time and is read after each burst
+        while (tx_size[UP_LINK] > 0) {
+            wire(UP_LINK, 1 + rand() % 12);
+            dma_physical_recv();
+        }
+        sent += 2;
+        assert_that(num_received, is_equal_to(2));
+        assert_that(received[0], is_equal_to_contents_of(data[0], sizeof(data[0])));
+        assert_that(received[1], is_equal_to_contents_of(data[1], sizeof(data[1])));
+        num_received = 0;
+    }
+    assert_that(link_stats.links[DOWN_LINK].frames, is_equal_to(sent));
+}
+
+Ensure(DMALoopback, drops_a_frame_that_doesnt_fit_and_counts_it) {
+    uint8_t data[3][16];
+    uint8_t i;
+    for (i=0;i<3;i++) {
+        fill(data[i], sizeof(data[i]), i);
+        send(UP_LINK, data[i], sizeof(data[i]));
+    }
+    // Two frames of 22 bytes fill the 48 byte buffer
+    assert_that(link_stats.links[UP_LINK].tx_drops, is_equal_to(1));
+    wire_all();
+    dma_physical_recv();
+    assert_that(num_received, is_equal_to(2));
+    assert_that(received[0], is_equal_to_contents_of(data[0], sizeof(data[0])));
+    assert_that(received[1], is_equal_to_contents_of(data[1], sizeof(data[1])));
+
+    send(UP_LINK, data[2], sizeof(data[2]));
+    wire_all();
+    dma_physical_recv();
+    assert_that(num_received, is_equal_to(3));
+    assert_that(received[2], is_equal_to_contents_of(data[2], sizeof(data[2])));
+}
+
+Ensure(DMALoopback, sends_both_ways_at_once) {
+    uint8_t up[12];
+    uint8_t down[17];
+    uint8_t round;
+    for (round=0;round<10;round++) {
+        fill(up, sizeof(up), round);
+        fill(down, sizeof(down), round + 100);
+        send(UP_LINK, up, sizeof(up));
+        send(DOWN_LINK, down, sizeof(down));
+        while (tx_size[UP_LINK] > 0 || tx_size[DOWN_LINK] > 0) {
+            wire(UP_LINK, 3);
+            wire(DOWN_LINK, 5);
+            dma_physical_recv();
+        }
+        assert_that(num_received, is_equal_to(2));
+        uint8_t i;
+        for (i=0;i<2;i++) {
+            if (received_link[i] == DOWN_LINK) {
+                assert_that(received[i], is_equal_to_contents_of(up, sizeof(up)));
+            }
+            else {
+                assert_that(received[i], is_equal_to_contents_of(down, sizeof(down)));
+            }
+        }
+        assert_that(received_link[0], is_not_equal_to(received_link[1]));
+        num_received = 0;
+    }
+}
+
+Ensure(DMALoopback, reads_a_dma_position_at_the_end_of_the_buffer_as_0) {
+    rx_pos_at_end = true;
+    uint8_t i;
+    for (i=0;i<20;i++) {
+        uint8_t data[9];
+        fill(data, sizeof(data), i);
+        send(DOWN_LINK, data, sizeof(data));
+        wire_all();
+        dma_physical_recv();
+        assert_that(num_received, is_equal_to(1));
+        assert_that(received_link[0], is_equal_to(UP_LINK));
+        assert_that(received[0], is_equal_to_contents_of(data, sizeof(data)));
+        num_received = 0;
+    }
+}
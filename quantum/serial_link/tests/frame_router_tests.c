@@ -27,6 +27,7 @@ SOFTWARE.
 #include "serial_link/protocol/byte_stuffer.c"
 #include "serial_link/protocol/frame_validator.c"
 #include "serial_link/protocol/frame_router.c"
+#include "serial_link/protocol/link_stats.c"
 #include "serial_link/protocol/transport.h"
 
 static uint8_t received_data[256];
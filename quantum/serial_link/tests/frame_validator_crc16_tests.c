@@ -0,0 +1,73 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#define SERIAL_LINK_CRC_SIZE 2
+#include <cgreen/cgreen.h>
+#include <cgreen/mocks.h>
+#include "serial_link/protocol/frame_validator.c"
+#include "serial_link/protocol/link_stats.c"
+
+void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size) {
+    mock(data, size);
+}
+
+void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
+    mock(data, size);
+}
+
+Describe(FrameValidatorCrc16);
+BeforeEach(FrameValidatorCrc16) {}
+AfterEach(FrameValidatorCrc16) {}
+
+Ensure(FrameValidatorCrc16, doesnt_validate_frames_under_3_bytes) {
+    never_expect(route_incoming_frame);
+    uint8_t data[] = {1, 2};
+    validator_recv_frame(0, 0, 1);
+    validator_recv_frame(0, data, 2);
+}
+
+Ensure(FrameValidatorCrc16, validates_one_byte_frame_with_correct_crc) {
+    uint8_t data[] = {0x44, 0xB0, 0xE9};
+    expect(route_incoming_frame,
+        when(size, is_equal_to(1)),
+        when(data, is_equal_to_contents_of(data, 1))
+    );
+    validator_recv_frame(0, data, 3);
+}
+
+Ensure(FrameValidatorCrc16, does_not_validate_one_byte_frame_with_incorrect_crc) {
+    uint8_t data[] = {0x44, 0xE9, 0xB0};
+    never_expect(route_incoming_frame);
+    validator_recv_frame(0, data, 3);
+}
+
+Ensure(FrameValidatorCrc16, sends_nine_bytes_with_correct_crc) {
+    uint8_t original[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9', 0, 0};
+    uint8_t expected[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9', 0xB1, 0x29};
+    expect(byte_stuffer_send_frame,
+        when(size, is_equal_to(sizeof(expected))),
+        when(data, is_equal_to_contents_of(expected, sizeof(expected)))
+    );
+    validator_send_frame(0, original, 9);
+}
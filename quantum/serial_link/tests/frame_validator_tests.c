@@ -25,6 +25,7 @@ SOFTWARE.
 #include <cgreen/cgreen.h>
 #include <cgreen/mocks.h>
 #include "serial_link/protocol/frame_validator.c"
+#include "serial_link/protocol/link_stats.c"
 
 void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size) {
     mock(data, size);
@@ -35,7 +36,9 @@ void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
 }
 
 Describe(FrameValidator);
-BeforeEach(FrameValidator) {}
+BeforeEach(FrameValidator) {
+    memset(&link_stats, 0, sizeof(link_stats));
+}
 AfterEach(FrameValidator) {}
 
 Ensure(FrameValidator, doesnt_validate_frames_under_5_bytes) {
@@ -54,12 +57,16 @@ Ensure(FrameValidator, validates_one_byte_frame_with_correct_crc) {
         when(data, is_equal_to_contents_of(data, 1))
     );
     validator_recv_frame(0, data, 5);
+    assert_that(link_stats.links[0].frames, is_equal_to(1));
+    assert_that(link_stats.links[0].crc_errors, is_equal_to(0));
 }
 
 Ensure(FrameValidator, does_not_validate_one_byte_frame_with_incorrect_crc) {
     uint8_t data[] = {0x44, 0, 0, 0, 0};
     never_expect(route_incoming_frame);
     validator_recv_frame(1, data, 5);
+    assert_that(link_stats.links[1].crc_errors, is_equal_to(1));
+    assert_that(link_stats.links[1].frames, is_equal_to(0));
 }
 
 Ensure(FrameValidator, validates_four_byte_frame_with_correct_crc) {
@@ -99,3 +106,30 @@ Ensure(FrameValidator, sends_five_bytes_with_correct_crc) {
     );
     validator_send_frame(0, original, 5);
 }
+
+Ensure(FrameValidator, validates_nine_byte_frame_with_correct_crc) {
+    uint8_t data[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9', 0x26, 0x39, 0xF4, 0xCB};
+    expect(route_incoming_frame,
+        when(size, is_equal_to(9)),
+        when(data, is_equal_to_contents_of(data, 9))
+    );
+    validator_recv_frame(0, data, 13);
+}
+
+Ensure(FrameValidator, sends_twenty_bytes_with_correct_crc) {
+    uint8_t original[24] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20};
+    uint8_t expected[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20,
+        0xF8, 0xDF, 0x89, 0x57};
+    expect(byte_stuffer_send_frame,
+        when(size, is_equal_to(sizeof(expected))),
+        when(data, is_equal_to_contents_of(expected, sizeof(expected)))
+    );
+    validator_send_frame(0, original, 20);
+}
+
+Ensure(FrameValidator, does_not_validate_twenty_byte_frame_with_a_flipped_bit) {
+    uint8_t data[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20 ^ 0x80,
+        0xF8, 0xDF, 0x89, 0x57};
+    never_expect(route_incoming_frame);
+    validator_recv_frame(0, data, sizeof(data));
+}
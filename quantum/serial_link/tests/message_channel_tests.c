@@ -0,0 +1,255 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cgreen/cgreen.h>
+#include <cgreen/mocks.h>
+#include <stdlib.h>
+#include "serial_link/protocol/message_channel.c"
+#include "serial_link/protocol/link_stats.c"
+
+// Both ends of the link live in this process: the master talks to slave 1
+// through channel 1, and slave 1 talks to the master through channel 0.
+// Sent frames go into a simulated link that can drop and delay them.
+
+#define MAX_FRAMES 256
+
+typedef struct {
+    uint8_t data[64];
+    uint16_t size;
+    uint8_t from;
+    uint16_t deliver_at;
+} link_frame_t;
+
+static link_frame_t link_frames[MAX_FRAMES];
+static uint16_t num_link_frames;
+static uint16_t now;
+static uint8_t loss_percent;
+static uint8_t max_delay;
+static uint32_t frames_sent;
+
+void signal_data_written(void) {
+}
+
+void router_send_frame(uint8_t destination, uint8_t* data, uint16_t size) {
+    frames_sent++;
+    if (rand() % 100 < loss_percent || num_link_frames == MAX_FRAMES) {
+        return;
+    }
+    link_frame_t* frame = &link_frames[num_link_frames++];
+    memcpy(frame->data, data, size);
+    frame->size = size;
+    // The master sends to slave 1 and slave 1 to the master
+    frame->from = destination == 0 ? 1 : 0;
+    frame->deliver_at = now + (max_delay ? rand() % (max_delay + 1) : 0);
+}
+
+static uint8_t received[2][4096];
+static uint16_t received_size[2];
+static uint16_t num_received[2];
+
+void message_channel_received(uint8_t peer, const uint8_t* data, uint8_t size) {
+    memcpy(received[peer] + received_size[peer], data, size);
+    received_size[peer] += size;
+    num_received[peer]++;
+}
+
+// Delivers the frames that are due, like the transport would
+static void deliver(void) {
+    uint16_t i = 0;
+    while (i < num_link_frames) {
+        link_frame_t* frame = &link_frames[i];
+        if ((int16_t)(now - frame->deliver_at) >= 0) {
+            link_frame_t copy = *frame;
+            memmove(frame, frame + 1, (num_link_frames - i - 1) * sizeof(link_frame_t));
+            num_link_frames--;
+            assert_that(copy.data[copy.size - 1], is_equal_to(MESSAGE_CHANNEL_ID));
+            message_channel_recv_frame(copy.from, copy.data, copy.size - 1);
+        }
+        else {
+            i++;
+        }
+    }
+}
+
+static void run_for(uint16_t ms) {
+    uint16_t end = now + ms;
+    while (now != end) {
+        deliver();
+        update_message_channel(now);
+        now++;
+    }
+}
+
+Describe(MessageChannel);
+BeforeEach(MessageChannel) {
+    init_message_channel();
+    num_link_frames = 0;
+    now = 1000;
+    loss_percent = 0;
+    max_delay = 0;
+    frames_sent = 0;
+    memset(received_size, 0, sizeof(received_size));
+    memset(num_received, 0, sizeof(num_received));
+    memset(&link_stats, 0, sizeof(link_stats));
+    srand(3);
+}
+AfterEach(MessageChannel) {}
+
+Ensure(MessageChannel, batches_messages_into_one_frame) {
+    assert_that(message_channel_send(1, "ab", 2), is_equal_to(true));
+    assert_that(message_channel_send(1, "c", 1), is_equal_to(true));
+    assert_that(message_channel_send(1, "defg", 4), is_equal_to(true));
+    update_message_channel(now);
+    assert_that(num_link_frames, is_equal_to(1));
+    uint8_t expected[] = {0, 0, 2, 'a', 'b', 1, 'c', 4, 'd', 'e', 'f', 'g', MESSAGE_CHANNEL_ID};
+    assert_that(link_frames[0].size, is_equal_to(sizeof(expected)));
+    assert_that(link_frames[0].data, is_equal_to_contents_of(expected, sizeof(expected)));
+}
+
+Ensure(MessageChannel, doesnt_send_anything_without_messages) {
+    update_message_channel(now);
+    assert_that(frames_sent, is_equal_to(0));
+}
+
+Ensure(MessageChannel, rejects_messages_that_dont_fit_the_batch) {
+    uint8_t data[SERIAL_LINK_MESSAGE_FRAME_SIZE] = {};
+    assert_that(message_channel_send(1, data, SERIAL_LINK_MESSAGE_FRAME_SIZE), is_equal_to(false));
+    assert_that(message_channel_send(1, data, SERIAL_LINK_MESSAGE_FRAME_SIZE - 1), is_equal_to(true));
+    assert_that(message_channel_send(1, data, 0), is_equal_to(false));
+    update_message_channel(now);
+    assert_that(message_channel_send(1, data, 0), is_equal_to(true));
+}
+
+Ensure(MessageChannel, rejects_messages_to_unknown_peers) {
+    assert_that(message_channel_send(NUM_SLAVES + 1, "a", 1), is_equal_to(false));
+}
+
+Ensure(MessageChannel, delivers_messages_in_order_and_acknowledges_them) {
+    message_channel_send(1, "x", 1);
+    message_channel_send(1, "yz", 2);
+    run_for(2);
+    assert_that(num_received[0], is_equal_to(2));
+    assert_that(received[0], is_equal_to_contents_of("xyz", 3));
+    // The acknowledgement went back on the same update
+    run_for(1);
+    assert_that(num_link_frames, is_equal_to(0));
+    assert_that(channels[1].first_unacked, is_equal_to(1));
+    run_for(100);
+    assert_that(frames_sent, is_equal_to(2));
+}
+
+Ensure(MessageChannel, retransmits_a_lost_frame_after_the_timeout) {
+    message_channel_send(1, "x", 1);
+    loss_percent = 100;
+    run_for(1);
+    loss_percent = 0;
+    run_for(SERIAL_LINK_MESSAGE_TIMEOUT_MS - 1);
+    assert_that(num_received[0], is_equal_to(0));
+    run_for(2);
+    assert_that(num_received[0], is_equal_to(1));
+    assert_that(link_stats.retransmits, is_equal_to(1));
+    // The acknowledgement can't tell which copy arrived
+    run_for(2);
+    assert_that(channels[1].first_unacked, is_equal_to(1));
+    assert_that(link_stats.rtt_ms, is_equal_to(0));
+}
+
+Ensure(MessageChannel, measures_the_round_trip_time) {
+    message_channel_send(1, "x", 1);
+    // Sent, received and acknowledged, and the acknowledgement received
+    run_for(3);
+    assert_that(link_stats.rtt_ms, is_equal_to(2));
+    assert_that(link_stats.rtt_max_ms, is_equal_to(2));
+    assert_that(link_stats.retransmits, is_equal_to(0));
+}
+
+Ensure(MessageChannel, delivers_a_retransmitted_duplicate_only_once) {
+    message_channel_send(1, "x", 1);
+    run_for(1);
+    // Lose the acknowledgement
+    loss_percent = 100;
+    run_for(1);
+    loss_percent = 0;
+    run_for(SERIAL_LINK_MESSAGE_TIMEOUT_MS + 2);
+    assert_that(frames_sent, is_equal_to(4));
+    assert_that(num_received[0], is_equal_to(1));
+    assert_that(channels[1].first_unacked, is_equal_to(1));
+}
+
+Ensure(MessageChannel, stops_sending_when_the_window_is_full) {
+    loss_percent = 100;
+    int i;
+    for (i=0;i<SERIAL_LINK_MESSAGE_WINDOW + 2;i++) {
+        assert_that(message_channel_send(1, "m", 1), is_equal_to(true));
+        update_message_channel(now);
+    }
+    assert_that(frames_sent, is_equal_to(SERIAL_LINK_MESSAGE_WINDOW));
+    // The last message waits in the batch
+    assert_that(message_channel_send(1, "m", 1), is_equal_to(true));
+}
+
+Ensure(MessageChannel, asks_to_be_called_again_for_the_retransmission) {
+    assert_that(update_message_channel(now), is_equal_to(UINT16_MAX));
+    message_channel_send(1, "x", 1);
+    assert_that(update_message_channel(now), is_equal_to(SERIAL_LINK_MESSAGE_TIMEOUT_MS));
+    assert_that(update_message_channel(now + 5), is_equal_to(SERIAL_LINK_MESSAGE_TIMEOUT_MS - 5));
+}
+
+static void exchange_over_lossy_link(uint8_t loss, uint8_t delay) {
+    const uint32_t count = 300;
+    uint32_t next[2] = {0, 0};
+    loss_percent = loss;
+    max_delay = delay;
+    uint32_t ms;
+    for (ms = 0; ms < 60000 && (num_received[0] < count || num_received[1] < count); ms++) {
+        // Both sides send counters, several per update when there's room
+        uint8_t peer;
+        for (peer = 0; peer < 2; peer++) {
+            while (next[peer] < count && rand() % 4 != 0 &&
+                    message_channel_send(peer == 0 ? 1 : 0, &next[peer], sizeof(uint32_t))) {
+                next[peer]++;
+            }
+        }
+        run_for(1);
+    }
+    // received[0] is what the slave got from the master, and the other way round
+    uint8_t side;
+    for (side = 0; side < 2; side++) {
+        assert_that(num_received[side], is_equal_to(count));
+        uint32_t i;
+        for (i = 0; i < count; i++) {
+            uint32_t value;
+            memcpy(&value, received[side] + i * sizeof(uint32_t), sizeof(uint32_t));
+            assert_that(value, is_equal_to(i));
+        }
+    }
+}
+
+Ensure(MessageChannel, delivers_everything_in_order_over_a_lossy_link) {
+    exchange_over_lossy_link(30, 0);
+}
+
+Ensure(MessageChannel, delivers_everything_in_order_over_a_lossy_reordering_link) {
+    exchange_over_lossy_link(20, 8);
+}
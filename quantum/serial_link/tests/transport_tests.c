@@ -24,6 +24,7 @@ SOFTWARE.
 
 #include <cgreen/cgreen.h>
 #include <cgreen/mocks.h>
+#include <stdlib.h>
 #include "serial_link/protocol/transport.c"
 #include "serial_link/protocol/triple_buffered_object.c"
 
@@ -31,6 +32,20 @@ void signal_data_written(void) {
     mock();
 }
 
+void message_channel_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
+    mock(from, data, size);
+}
+
+static const char* reported_names[SERIAL_LINK_MAX_REMOTE_OBJECTS];
+static uint32_t reported_sizes[SERIAL_LINK_MAX_REMOTE_OBJECTS];
+static uint32_t num_reported;
+
+void report_remote_object_memory(const char* name, uint32_t size) {
+    reported_names[num_reported] = name;
+    reported_sizes[num_reported] = size;
+    num_reported++;
+}
+
 static uint8_t sent_data[2048];
 static uint16_t sent_data_size;
 
@@ -53,14 +68,22 @@ MASTER_TO_ALL_SLAVES_OBJECT(master_to_slave, test_object1_t);
 MASTER_TO_SINGLE_SLAVE_OBJECT(master_to_single_slave, test_object1_t);
 SLAVE_TO_MASTER_OBJECT(slave_to_master, test_object1_t);
 
+typedef struct {
+    uint16_t rows[16];
+} test_matrix_t;
+
+SLAVE_TO_MASTER_DELTA_OBJECT(slave_matrix, test_matrix_t, uint16_t);
+
 static remote_object_t* test_remote_objects[] = {
     REMOTE_OBJECT(master_to_slave),
     REMOTE_OBJECT(master_to_single_slave),
     REMOTE_OBJECT(slave_to_master),
+    REMOTE_OBJECT(slave_matrix),
 };
 
 Describe(Transport);
 BeforeEach(Transport) {
+    num_reported = 0;
     add_remote_objects(test_remote_objects, sizeof(test_remote_objects) / sizeof(remote_object_t*));
     sent_data_size = 0;
 }
@@ -166,3 +189,178 @@ Ensure(Transport, ignores_object_with_size_too_big) {
     test_object1_t* obj2 = read_master_to_slave();
     assert_that(obj2, is_equal_to(NULL));
 }
+
+static test_matrix_t slave_matrix;
+
+// Writes the matrix on the slave side and returns the size of the frame sent
+static uint16_t send_slave_matrix(void) {
+    test_matrix_t* m = begin_write_slave_matrix();
+    *m = slave_matrix;
+    expect(signal_data_written);
+    end_write_slave_matrix();
+    expect(router_send_frame,
+            when(destination, is_equal_to(0)));
+    sent_data_size = 0;
+    update_transport();
+    return sent_data_size;
+}
+
+Ensure(Transport, delta_object_sends_a_snapshot_first) {
+    slave_matrix.rows[3] = 0x1234;
+    assert_that(send_slave_matrix(), is_equal_to(1 + sizeof(test_matrix_t) + 1));
+    transport_recv_frame(2, sent_data, sent_data_size);
+    test_matrix_t* m = read_slave_matrix(1);
+    assert_that(m, is_not_equal_to(NULL));
+    assert_that(m->rows[3], is_equal_to(0x1234));
+    assert_that(read_slave_matrix(0), is_equal_to(NULL));
+}
+
+Ensure(Transport, delta_object_sends_only_the_changed_rows) {
+    send_slave_matrix();
+    transport_recv_frame(1, sent_data, sent_data_size);
+    read_slave_matrix(0);
+
+    slave_matrix.rows[0] = 5;
+    slave_matrix.rows[15] = 0x8000;
+    // header, 2 bytes of bitmap, 2 rows and the id
+    assert_that(send_slave_matrix(), is_equal_to(1 + 2 + 4 + 1));
+    transport_recv_frame(1, sent_data, sent_data_size);
+    test_matrix_t* m = read_slave_matrix(0);
+    assert_that(m, is_not_equal_to(NULL));
+    assert_that(m, is_equal_to_contents_of(&slave_matrix, sizeof(test_matrix_t)));
+}
+
+Ensure(Transport, delta_object_sends_a_heartbeat_when_nothing_changed) {
+    send_slave_matrix();
+    transport_recv_frame(1, sent_data, sent_data_size);
+    read_slave_matrix(0);
+
+    assert_that(send_slave_matrix(), is_equal_to(2));
+    transport_recv_frame(1, sent_data, sent_data_size);
+    assert_that(read_slave_matrix(0), is_equal_to(NULL));
+
+    slave_matrix.rows[7] = 1;
+    send_slave_matrix();
+    transport_recv_frame(1, sent_data, sent_data_size);
+    test_matrix_t* m = read_slave_matrix(0);
+    assert_that(m, is_not_equal_to(NULL));
+    assert_that(m->rows[7], is_equal_to(1));
+}
+
+Ensure(Transport, delta_object_resyncs_on_the_first_heartbeat_after_a_lost_delta) {
+    send_slave_matrix();
+    transport_recv_frame(1, sent_data, sent_data_size);
+    read_slave_matrix(0);
+
+    // Lost
+    slave_matrix.rows[1] = 1;
+    send_slave_matrix();
+
+    assert_that(send_slave_matrix(), is_equal_to(1 + sizeof(test_matrix_t) + 1));
+    transport_recv_frame(1, sent_data, sent_data_size);
+    test_matrix_t* m = read_slave_matrix(0);
+    assert_that(m, is_not_equal_to(NULL));
+    assert_that(m, is_equal_to_contents_of(&slave_matrix, sizeof(test_matrix_t)));
+
+    // Back to plain heartbeats, and in sync for the next delta
+    assert_that(send_slave_matrix(), is_equal_to(2));
+    slave_matrix.rows[2] = 2;
+    send_slave_matrix();
+    transport_recv_frame(1, sent_data, sent_data_size);
+    m = read_slave_matrix(0);
+    assert_that(m, is_not_equal_to(NULL));
+    assert_that(m->rows[2], is_equal_to(2));
+}
+
+Ensure(Transport, delta_object_resyncs_after_the_snapshot_interval_while_changing) {
+    send_slave_matrix();
+    transport_recv_frame(1, sent_data, sent_data_size);
+    read_slave_matrix(0);
+
+    // Lost
+    slave_matrix.rows[1] = 1;
+    send_slave_matrix();
+
+    int i;
+    for (i=0;i<SERIAL_LINK_DELTA_SNAPSHOT_INTERVAL - 1;i++) {
+        slave_matrix.rows[2] = i + 2;
+        assert_that(send_slave_matrix(), is_equal_to(1 + 2 + 2 + 1));
+        transport_recv_frame(1, sent_data, sent_data_size);
+        assert_that(read_slave_matrix(0), is_equal_to(NULL));
+    }
+
+    slave_matrix.rows[2] = 0x100;
+    assert_that(send_slave_matrix(), is_equal_to(1 + sizeof(test_matrix_t) + 1));
+    transport_recv_frame(1, sent_data, sent_data_size);
+    test_matrix_t* m = read_slave_matrix(0);
+    assert_that(m, is_not_equal_to(NULL));
+    assert_that(m, is_equal_to_contents_of(&slave_matrix, sizeof(test_matrix_t)));
+}
+
+Ensure(Transport, delta_object_sends_a_snapshot_when_most_rows_changed) {
+    send_slave_matrix();
+    int i;
+    for (i=0;i<16;i++) {
+        slave_matrix.rows[i] = i + 1;
+    }
+    assert_that(send_slave_matrix(), is_equal_to(1 + sizeof(test_matrix_t) + 1));
+}
+
+Ensure(Transport, delta_object_ignores_a_delta_with_the_wrong_size) {
+    send_slave_matrix();
+    transport_recv_frame(1, sent_data, sent_data_size);
+    read_slave_matrix(0);
+
+    slave_matrix.rows[4] = 4;
+    uint16_t size = send_slave_matrix();
+    sent_data[size - 2] = sent_data[size - 1];
+    transport_recv_frame(1, sent_data, size - 1);
+    assert_that(read_slave_matrix(0), is_equal_to(NULL));
+}
+
+Ensure(Transport, delta_object_ignores_a_delta_cut_short_in_the_bitmap) {
+    send_slave_matrix();
+    transport_recv_frame(1, sent_data, sent_data_size);
+    read_slave_matrix(0);
+
+    slave_matrix.rows[4] = 4;
+    send_slave_matrix();
+    // Only the header and the id, moved to a buffer of that size
+    uint8_t* frame = malloc(2);
+    frame[0] = sent_data[0];
+    frame[1] = sent_data[sent_data_size - 1];
+    transport_recv_frame(1, frame, 2);
+    free(frame);
+    assert_that(read_slave_matrix(0), is_equal_to(NULL));
+}
+
+Ensure(Transport, reports_the_memory_used_by_each_object) {
+    assert_that(num_reported, is_equal_to(4));
+    assert_that(reported_names[0], is_equal_to_string("master_to_slave"));
+    assert_that(reported_sizes[0], is_equal_to(sizeof(remote_object_master_to_slave)));
+    assert_that(reported_names[1], is_equal_to_string("master_to_single_slave"));
+    assert_that(reported_sizes[1], is_equal_to(sizeof(remote_object_master_to_single_slave)));
+    assert_that(reported_names[2], is_equal_to_string("slave_to_master"));
+    assert_that(reported_sizes[2], is_equal_to(sizeof(remote_object_slave_to_master)));
+    assert_that(reported_names[3], is_equal_to_string("slave_matrix"));
+    assert_that(reported_sizes[3], is_equal_to(sizeof(remote_object_slave_matrix)));
+}
+
+Ensure(Transport, doesnt_add_more_objects_than_fit) {
+    int i;
+    for (i=4;i<SERIAL_LINK_MAX_REMOTE_OBJECTS;i++) {
+        assert_that(add_remote_objects(test_remote_objects, 1), is_equal_to(true));
+    }
+    assert_that(add_remote_objects(test_remote_objects, 1), is_equal_to(false));
+    assert_that(num_reported, is_equal_to(SERIAL_LINK_MAX_REMOTE_OBJECTS));
+}
+
+Ensure(Transport, passes_message_channel_frames_on) {
+    uint8_t data[] = {1, 2, 3, MESSAGE_CHANNEL_ID};
+    expect(message_channel_recv_frame,
+        when(from, is_equal_to(2)),
+        when(size, is_equal_to(3)),
+        when(data, is_equal_to_contents_of(data, 3))
+    );
+    transport_recv_frame(2, data, sizeof(data));
+}
@@ -23,6 +23,8 @@ SOFTWARE.
 */
 
 #include <cgreen/cgreen.h>
+#include <pthread.h>
+#include <sched.h>
 #include "serial_link/protocol/triple_buffered_object.c"
 
 typedef struct {
@@ -80,3 +82,71 @@ Ensure(TripleBufferedObject, performs_two_writes_in_the_middle_of_read) {
     assert_that(*triple_buffer_read(&test_object), is_equal_to(3));
     assert_that(triple_buffer_read(&test_object), is_equal_to(NULL));
 }
+
+#define STRESS_WRITES 200000
+
+typedef struct {
+    uint32_t sequence;
+    uint32_t copies[15];
+} stress_value_t;
+
+typedef struct {
+    uint8_t state;
+    stress_value_t buffer[3];
+} stress_object_t;
+
+static stress_object_t stress_object;
+
+static void* stress_writer(void* arg) {
+    (void)arg;
+    uint32_t i;
+    for (i=1;i<=STRESS_WRITES;i++) {
+        stress_value_t* value = triple_buffer_begin_write(&stress_object);
+        value->sequence = i;
+        int j;
+        for (j=0;j<15;j++) {
+            value->copies[j] = i;
+            // Let the reader in half way through a write now and then
+            if (j == 7 && (i & 1023) == 0) {
+                sched_yield();
+            }
+        }
+        triple_buffer_end_write(&stress_object);
+    }
+    return NULL;
+}
+
+Ensure(TripleBufferedObject, reader_never_sees_a_torn_write_from_another_thread) {
+    triple_buffer_init((triple_buffer_object_t*)&stress_object);
+    pthread_t writer;
+    pthread_create(&writer, NULL, stress_writer, NULL);
+    uint32_t last = 0;
+    uint32_t reads = 0;
+    uint32_t torn = 0;
+    uint32_t out_of_order = 0;
+    while (last != STRESS_WRITES) {
+        stress_value_t* value = triple_buffer_read(&stress_object);
+        if (value) {
+            uint32_t sequence = value->sequence;
+            int j;
+            for (j=0;j<15;j++) {
+                torn += value->copies[j] != sequence;
+            }
+            // Hold on to the buffer for a while now and then, so that the
+            // writer laps the reader
+            if ((reads & 63) == 0) {
+                sched_yield();
+            }
+            for (j=0;j<15;j++) {
+                torn += __atomic_load_n(&value->copies[j], __ATOMIC_RELAXED) != sequence;
+            }
+            out_of_order += sequence <= last;
+            last = sequence;
+            reads++;
+        }
+    }
+    pthread_join(writer, NULL);
+    assert_that(torn, is_equal_to(0));
+    assert_that(out_of_order, is_equal_to(0));
+    assert_that(reads, is_greater_than(1));
+}
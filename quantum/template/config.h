@@ -48,6 +48,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 /* COL2ROW or ROW2COL */
 #define DIODE_DIRECTION COL2ROW
+
+/* microseconds a selected row needs to settle before reading, default 30 */
+//#define MATRIX_IO_DELAY 5
  
 // #define BACKLIGHT_PIN B7
 // #define BACKLIGHT_BREATHING
@@ -56,10 +59,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 /* Debounce reduces chatter (unintended double-presses) - set 0 if debouncing is not needed */
 #define DEBOUNCING_DELAY 5
+/* DEBOUNCE_DEFER_PK (default), DEBOUNCE_EAGER_PK or DEBOUNCE_DEFER_GLOBAL */
+//#define DEBOUNCE_ALGORITHM DEBOUNCE_EAGER_PK
 
 /* define if matrix has ghost (lacks anti-ghosting diodes) */
 //#define MATRIX_HAS_GHOST
 
+/* process all key changes of a scan at once instead of one key per scan */
+//#define BATCH_KEY_EVENTS
+
 /* number of backlight levels */
 
 /* Mechanical locking support. Use KC_LCAP, KC_LNUM or KC_LSCR instead in keymap */
@@ -146,6 +154,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *  These options are also useful to firmware size reduction.
  */
 
+/* events buffered while a tap key is undecided, power of two up to 128 */
+//#define WAITING_BUFFER_SIZE 16
+
+/* remember the resolved layer of each key until the layer state changes */
+//#define LAYER_LOOKUP_CACHE
+
+/* measure matrix scans per second, shown in the magic status command */
+//#define DEBUG_MATRIX_SCAN_RATE
+
 /* disable debug print */
 //#define NO_DEBUG
 
@@ -0,0 +1,84 @@
+// Time to render one rainbow swirl frame on the host, with the old
+// division based conversion per LED, the current per LED conversion and
+// the palette. Built and run by "make benchmark".
+//
+// The cycles are host TSC cycles, they only compare the three against
+// each other and don't predict the cycles on an AVR.
+#include <stdio.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC
+#endif
+#include "rgblight_hsv.c"
+#include "hsv_reference.h"
+
+#define MAX_LEDS 128
+
+static struct cRGB leds[MAX_LEDS];
+
+typedef void (*render_t)(uint16_t hue, uint8_t count);
+
+static void render_reference(uint16_t hue, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        reference_sethsv((360 / count * i + hue) % 360, 255, 200, &leds[i]);
+    }
+}
+
+static void render_sethsv(uint16_t hue, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        sethsv((360 / count * i + hue) % 360, 255, 200, &leds[i]);
+    }
+}
+
+static void render_palette(uint16_t hue, uint8_t count) {
+    static hsv_palette_t palette;
+    hsv_palette_update(&palette, 255, 200);
+    hsv_palette_render(&palette, hue, 360 / count, leds, count);
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t cycles(void) {
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void run(const char* name, render_t render, uint8_t count) {
+    volatile uint8_t sink = 0;
+    uint32_t frames = 0;
+    uint16_t hue = 0;
+    uint64_t start_cycles = cycles();
+    double start = now_s();
+    double elapsed;
+    do {
+        for (unsigned i = 0; i < 1000; i++) {
+            render(hue, count);
+            sink ^= leds[count - 1].g;
+            hue = hue == 359 ? 0 : hue + 1;
+        }
+        frames += 1000;
+        elapsed = now_s() - start;
+    } while (elapsed < 0.2);
+    uint64_t used_cycles = cycles() - start_cycles;
+    (void)sink;
+    printf("%-9s %3u LEDs: %8.1f ns/frame %8.0f cycles/frame\n", name, count,
+        elapsed * 1e9 / frames, (double)used_cycles / frames);
+}
+
+int main(void) {
+    static const uint8_t counts[] = {16, 64, 128};
+    for (unsigned i = 0; i < sizeof(counts); i++) {
+        run("division", render_reference, counts[i]);
+        run("sethsv", render_sethsv, counts[i]);
+        run("palette", render_palette, counts[i]);
+    }
+    return 0;
+}
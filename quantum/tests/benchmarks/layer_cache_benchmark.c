@@ -0,0 +1,100 @@
+// Cost of layer_switch_get_layer() on deep layer stacks, built once
+// without and once with LAYER_LOOKUP_CACHE by "make benchmark".
+//
+// Every layer of the stack is on, layer 0 is opaque and one key in eight
+// of the layers above it. Each run looks up random keys and toggles the
+// top layer every so many lookups, a layer key held now and then while
+// typing. A lookup is made per key event, so 64 lookups are about 32
+// keystrokes. The cache is dropped on every toggle and only pays off when
+// the layer state stays put for a while.
+//
+// The action_for_key() calls are what the AVR pays for, each one is a
+// keymap read from flash and a keycode decode. The host times only
+// compare the two builds against each other.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#define NO_PRINT
+#define MATRIX_ROWS 5
+#define MATRIX_COLS 14
+#include "action_layer.c"
+
+#ifdef LAYER_LOOKUP_CACHE
+#define VARIANT "cached"
+#else
+#define VARIANT "walk"
+#endif
+
+static uint8_t opaque[32][MATRIX_ROWS][MATRIX_COLS];
+static uint64_t action_lookups;
+
+action_t action_for_key(uint8_t layer, keypos_t key) {
+    action_t action;
+    action_lookups++;
+    action.code = opaque[layer][key.row][key.col] ? ACTION_KEY(KC_A) : ACTION_TRANSPARENT;
+    return action;
+}
+
+uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key) { return KC_A; }
+action_t action_for_keycode(uint16_t keycode) { action_t action = { .code = ACTION_KEY(keycode) }; return action; }
+void clear_keyboard_but_mods(void) {}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#define KEY_COUNT 4096
+static keypos_t keys[KEY_COUNT];
+
+static void run(uint8_t depth, uint16_t toggle_every) {
+    memset(opaque, 0, sizeof(opaque));
+    memset(opaque[0], 1, sizeof(opaque[0]));
+    for (uint8_t layer = 1; layer < depth; layer++) {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                opaque[layer][row][col] = (rand() & 7) == 0;
+            }
+        }
+    }
+    default_layer_set(1);
+    layer_clear();
+    layer_or(depth == 32 ? 0xFFFFFFFE : ((1UL << depth) - 1) & ~1UL);
+
+    for (uint16_t i = 0; i < KEY_COUNT; i++) {
+        keys[i].col = rand() % MATRIX_COLS;
+        keys[i].row = rand() % MATRIX_ROWS;
+    }
+
+    uint32_t calls = 0;
+    volatile int8_t sink = 0;
+    action_lookups = 0;
+    double start = now_s();
+    double elapsed;
+    do {
+        for (unsigned i = 0; i < KEY_COUNT; i++) {
+            if ((calls + i) % toggle_every == 0) {
+                layer_invert(depth - 1);
+            }
+            sink = layer_switch_get_layer(keys[i]);
+        }
+        calls += KEY_COUNT;
+        elapsed = now_s() - start;
+    } while (elapsed < 0.2);
+    (void)sink;
+    printf("%-6s %2u layers, toggle every %4u: %6.2f action_for_key/lookup %6.1f ns/lookup\n",
+        VARIANT, depth, toggle_every, (double)action_lookups / calls, elapsed * 1e9 / calls);
+}
+
+int main(void) {
+    srand(1);
+    static const uint8_t depths[] = { 8, 16, 32 };
+    static const uint16_t toggles[] = { 16, 64, 1024 };
+    for (uint8_t d = 0; d < sizeof(depths); d++) {
+        for (uint8_t t = 0; t < sizeof(toggles) / sizeof(toggles[0]); t++) {
+            run(depths[d], toggles[t]);
+        }
+    }
+    return 0;
+}
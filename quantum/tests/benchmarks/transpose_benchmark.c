@@ -0,0 +1,104 @@
+// Time to rebuild the rows of a ROW2COL matrix from its columns on the
+// host, with the nested loop matrix_scan() used before and with the
+// bittrans kernels matrix_transpose() uses now. Built and run by
+// "make benchmark".
+//
+// The cycles are host TSC cycles, they only compare the two against each
+// other. On an AVR the old loop costs more, it has no barrel shifter for
+// the per-bit shifts. Scans where nothing changed skip the rebuild, which
+// this doesn't show.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC
+#endif
+#include "util.c"
+
+typedef void (*transpose_t)(void);
+
+// The two rebuilds for a rows x cols matrix stored in row_t, with the
+// kernel that fits the row size. The arrays aren't static so the compiler
+// can't drop the stores to them.
+#define DEFINE_SIZE(rows, cols, row_t, kernel) \
+    row_t columns_##rows##x##cols[cols]; \
+    row_t rows_##rows##x##cols[rows]; \
+    static void loop_##rows##x##cols(void) { \
+        for (uint8_t y = 0; y < rows; y++) { \
+            row_t row = 0; \
+            for (uint8_t x = 0; x < cols; x++) { \
+                row |= ((columns_##rows##x##cols[x] & (1<<y)) >> y) << x; \
+            } \
+            rows_##rows##x##cols[y] = row; \
+        } \
+    } \
+    static void kernel_##rows##x##cols(void) { \
+        row_t square[sizeof(row_t) * 8] = { 0 }; \
+        for (uint8_t x = 0; x < cols; x++) { \
+            square[x] = columns_##rows##x##cols[x]; \
+        } \
+        kernel(square); \
+        for (uint8_t y = 0; y < rows; y++) { \
+            rows_##rows##x##cols[y] = square[y]; \
+        } \
+    } \
+    static void randomize_##rows##x##cols(void) { \
+        for (uint8_t x = 0; x < cols; x++) { \
+            columns_##rows##x##cols[x] = rand() & ((1 << rows) - 1); \
+        } \
+    }
+
+DEFINE_SIZE(8, 8, uint8_t, bittrans)
+DEFINE_SIZE(4, 12, uint16_t, bittrans16)
+DEFINE_SIZE(5, 14, uint16_t, bittrans16)
+DEFINE_SIZE(6, 16, uint16_t, bittrans16)
+DEFINE_SIZE(6, 24, uint32_t, bittrans32)
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t cycles(void) {
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void run(const char* name, const char* size, transpose_t transpose, transpose_t randomize) {
+    uint32_t calls = 0;
+    randomize();
+    uint64_t start_cycles = cycles();
+    double start = now_s();
+    double elapsed;
+    do {
+        for (unsigned i = 0; i < 1000; i++) {
+            transpose();
+            // keep the compiler from dropping the rebuilds
+            __asm__ volatile("" ::: "memory");
+        }
+        calls += 1000;
+        elapsed = now_s() - start;
+    } while (elapsed < 0.2);
+    uint64_t used_cycles = cycles() - start_cycles;
+    printf("%-8s %5s: %8.1f ns/rebuild %8.0f cycles/rebuild\n", name, size,
+        elapsed * 1e9 / calls, (double)used_cycles / calls);
+}
+
+#define RUN_SIZE(rows, cols) \
+    run("loop", #rows "x" #cols, loop_##rows##x##cols, randomize_##rows##x##cols); \
+    run("bittrans", #rows "x" #cols, kernel_##rows##x##cols, randomize_##rows##x##cols)
+
+int main(void) {
+    srand(1);
+    RUN_SIZE(8, 8);
+    RUN_SIZE(4, 12);
+    RUN_SIZE(5, 14);
+    RUN_SIZE(6, 16);
+    RUN_SIZE(6, 24);
+    return 0;
+}
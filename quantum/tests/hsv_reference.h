@@ -0,0 +1,62 @@
+// The HSV to RGB conversion as rgblight did it before the palette, with
+// the divisions. The tests check the current one against it and the
+// benchmark compares their speed.
+#ifndef HSV_REFERENCE_H
+#define HSV_REFERENCE_H
+
+#include "rgblight_hsv.h"
+
+extern const uint8_t DIM_CURVE[];
+
+static void reference_sethsv(uint16_t hue, uint8_t sat, uint8_t val, struct cRGB *led1) {
+    uint8_t r = 0, g = 0, b = 0;
+
+    val = pgm_read_byte(&DIM_CURVE[val]);
+    sat = 255 - pgm_read_byte(&DIM_CURVE[255 - sat]);
+
+    uint8_t base;
+
+    if (sat == 0) {
+        r = val;
+        g = val;
+        b = val;
+    } else {
+        base = ((255 - sat) * val) >> 8;
+
+        switch (hue / 60) {
+        case 0:
+            r = val;
+            g = (((val - base)*hue) / 60) + base;
+            b = base;
+            break;
+        case 1:
+            r = (((val - base)*(60 - (hue % 60))) / 60) + base;
+            g = val;
+            b = base;
+            break;
+        case 2:
+            r = base;
+            g = val;
+            b = (((val - base)*(hue % 60)) / 60) + base;
+            break;
+        case 3:
+            r = base;
+            g = (((val - base)*(60 - (hue % 60))) / 60) + base;
+            b = val;
+            break;
+        case 4:
+            r = (((val - base)*(hue % 60)) / 60) + base;
+            g = base;
+            b = val;
+            break;
+        case 5:
+            r = val;
+            g = base;
+            b = (((val - base)*(60 - (hue % 60))) / 60) + base;
+            break;
+        }
+    }
+    setrgb(r, g, b, led1);
+}
+
+#endif
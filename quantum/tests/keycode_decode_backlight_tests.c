@@ -0,0 +1,5 @@
+#include <cgreen/cgreen.h>
+#define NO_PRINT
+#define BACKLIGHT_ENABLE
+#include "matrix_test_config.h"
+#include "keycode_decode_body.h"
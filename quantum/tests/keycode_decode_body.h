@@ -0,0 +1,55 @@
+// The keycode decode tests, included by keycode_decode_tests.c and
+// keycode_decode_backlight_tests.c to run them with and without the
+// backlight keycodes
+#include "keymap_common.c"
+#include "keycode_config.c"
+#include "keycode_decode_reference.h"
+
+keymap_config_t keymap_config;
+const uint16_t keymaps[][MATRIX_ROWS][MATRIX_COLS] = { { { KC_A } } };
+
+// A distinct action for each of the 4096 function slots, so a read from
+// the wrong slot shows
+#define SLOTS_4(n) (n), (n) + 1, (n) + 2, (n) + 3
+#define SLOTS_16(n) SLOTS_4(n), SLOTS_4((n) + 4), SLOTS_4((n) + 8), SLOTS_4((n) + 12)
+#define SLOTS_64(n) SLOTS_16(n), SLOTS_16((n) + 16), SLOTS_16((n) + 32), SLOTS_16((n) + 48)
+#define SLOTS_256(n) SLOTS_64(n), SLOTS_64((n) + 64), SLOTS_64((n) + 128), SLOTS_64((n) + 192)
+#define SLOTS_1024(n) SLOTS_256(n), SLOTS_256((n) + 256), SLOTS_256((n) + 512), SLOTS_256((n) + 768)
+const uint16_t fn_actions[0x1000] = {
+    SLOTS_1024(0x9000), SLOTS_1024(0x9400), SLOTS_1024(0x9800), SLOTS_1024(0x9C00)
+};
+
+// First keycode the two decodes disagree on, 0 when there is none. 0 is
+// KC_NO, which both turn into ACTION_NO.
+static uint32_t first_mismatch(void) {
+    for (uint32_t keycode = 1; keycode <= 0xFFFF; keycode++) {
+        if (action_for_keycode(keycode).code != reference_action_for_keycode(keycode).code) {
+            return keycode;
+        }
+    }
+    return 0;
+}
+
+Describe(KeycodeDecode);
+BeforeEach(KeycodeDecode) {
+    keymap_config.raw = 0;
+}
+AfterEach(KeycodeDecode) {}
+
+Ensure(KeycodeDecode, matches_the_switch_for_every_keycode) {
+    assert_that(first_mismatch(), is_equal_to(0));
+}
+
+Ensure(KeycodeDecode, matches_the_switch_with_every_remapping) {
+    for (uint16_t config = 0; config < 0x100; config++) {
+        keymap_config.raw = config;
+        assert_that(first_mismatch(), is_equal_to(0));
+    }
+}
+
+Ensure(KeycodeDecode, reads_the_function_slot_of_the_keycode) {
+    assert_that(action_for_keycode(KC_FN0).code, is_equal_to(0x9000));
+    assert_that(action_for_keycode(KC_FN31).code, is_equal_to(0x9000 + 31));
+    assert_that(action_for_keycode(QK_FUNCTION).code, is_equal_to(0x9000));
+    assert_that(action_for_keycode(QK_FUNCTION_MAX).code, is_equal_to(0x9FFF));
+}
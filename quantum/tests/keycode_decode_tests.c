@@ -0,0 +1,4 @@
+#include <cgreen/cgreen.h>
+#define NO_PRINT
+#include "matrix_test_config.h"
+#include "keycode_decode_body.h"
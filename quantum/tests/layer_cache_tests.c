@@ -0,0 +1,147 @@
+#include <cgreen/cgreen.h>
+#include <stdlib.h>
+#define NO_PRINT
+#define LAYER_LOOKUP_CACHE
+#include "matrix_test_config.h"
+#include "action_layer.c"
+
+// Keymap stand-in, a key is transparent on a layer when its entry is 0
+static uint8_t opaque[32][MATRIX_ROWS][MATRIX_COLS];
+static uint32_t lookups;
+
+action_t action_for_key(uint8_t layer, keypos_t key) {
+    action_t action;
+    lookups++;
+    action.code = opaque[layer][key.row][key.col] ? ACTION_KEY(KC_A) : ACTION_TRANSPARENT;
+    return action;
+}
+
+uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key) { return KC_A; }
+action_t action_for_keycode(uint16_t keycode) { action_t action = { .code = ACTION_KEY(keycode) }; return action; }
+void clear_keyboard_but_mods(void) {}
+
+// layer_switch_get_layer() without the cache
+static int8_t reference_layer(keypos_t key) {
+    uint32_t layers = layer_state | default_layer_state;
+    for (int8_t i = 31; i >= 0; i--) {
+        if ((layers & (1UL << i)) && opaque[i][key.row][key.col]) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+static keypos_t key_at(uint8_t row, uint8_t col) {
+    keypos_t key = { .col = col, .row = row };
+    return key;
+}
+
+static bool every_key_matches_the_reference(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (layer_switch_get_layer(key_at(row, col)) != reference_layer(key_at(row, col))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// One key of each layer opaque, the rest of the layer transparent
+static void set_marker_layers(uint8_t count) {
+    memset(opaque, 0, sizeof(opaque));
+    for (uint8_t layer = 0; layer < count; layer++) {
+        opaque[layer][layer % MATRIX_ROWS][layer % MATRIX_COLS] = 1;
+    }
+    memset(opaque[0], 1, sizeof(opaque[0]));
+}
+
+Describe(LayerCache);
+BeforeEach(LayerCache) {
+    srand(1);
+    set_marker_layers(9);
+    layer_state = 0;
+    default_layer_state = 1;
+    layer_cache_clear();
+    lookups = 0;
+}
+AfterEach(LayerCache) {}
+
+Ensure(LayerCache, walks_the_layers_once_per_key) {
+    layer_or(0x1FE);
+    assert_that(every_key_matches_the_reference(), is_true);
+    uint32_t first = lookups;
+    assert_that(every_key_matches_the_reference(), is_true);
+    assert_that(lookups, is_equal_to(first));
+}
+
+Ensure(LayerCache, follows_layer_on_and_off) {
+    keypos_t key = key_at(3, 3);
+    assert_that(layer_switch_get_layer(key), is_equal_to(0));
+    layer_on(3);
+    assert_that(layer_switch_get_layer(key), is_equal_to(3));
+    layer_on(8);
+    assert_that(layer_switch_get_layer(key), is_equal_to(3));
+    layer_off(3);
+    assert_that(layer_switch_get_layer(key), is_equal_to(0));
+}
+
+Ensure(LayerCache, follows_layer_move_and_clear) {
+    keypos_t key = key_at(2, 2);
+    layer_move(2);
+    assert_that(layer_switch_get_layer(key), is_equal_to(2));
+    layer_move(5);
+    assert_that(layer_switch_get_layer(key), is_equal_to(0));
+    layer_invert(2);
+    assert_that(layer_switch_get_layer(key), is_equal_to(2));
+    layer_clear();
+    assert_that(layer_switch_get_layer(key), is_equal_to(0));
+}
+
+Ensure(LayerCache, follows_the_default_layer) {
+    keypos_t key = key_at(4, 4);
+    assert_that(layer_switch_get_layer(key), is_equal_to(0));
+    default_layer_set(1UL << 4);
+    assert_that(layer_switch_get_layer(key), is_equal_to(4));
+    default_layer_xor((1UL << 4) | 1);
+    assert_that(layer_switch_get_layer(key), is_equal_to(0));
+    default_layer_or(1UL << 4);
+    assert_that(layer_switch_get_layer(key), is_equal_to(4));
+    default_layer_and(1);
+    assert_that(layer_switch_get_layer(key), is_equal_to(0));
+}
+
+Ensure(LayerCache, follows_direct_writes_to_layer_state) {
+    keypos_t key = key_at(1, 1);
+    assert_that(layer_switch_get_layer(key), is_equal_to(0));
+    layer_state = 1UL << 1;
+    assert_that(layer_switch_get_layer(key), is_equal_to(1));
+}
+
+Ensure(LayerCache, picks_up_keymap_changes_after_clear) {
+    keypos_t key = key_at(0, 5);
+    layer_on(6);
+    assert_that(layer_switch_get_layer(key), is_equal_to(0));
+    opaque[6][0][5] = 1;
+    layer_cache_clear();
+    assert_that(layer_switch_get_layer(key), is_equal_to(6));
+}
+
+Ensure(LayerCache, matches_the_uncached_walk_for_random_states) {
+    for (uint8_t layer = 1; layer < 32; layer++) {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                opaque[layer][row][col] = (rand() & 7) == 0;
+            }
+        }
+    }
+    for (uint16_t n = 0; n < 2000; n++) {
+        switch (rand() & 3) {
+            case 0: layer_invert(rand() & 31); break;
+            case 1: default_layer_set(1UL << (rand() & 31)); break;
+            case 2: layer_xor(((uint32_t)rand() << 16) ^ rand()); break;
+            default: break;
+        }
+        assert_that(every_key_matches_the_reference(), is_true);
+    }
+}
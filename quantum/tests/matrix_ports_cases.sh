@@ -0,0 +1,49 @@
+#!/bin/sh
+# Writes the pin assignments for matrix_ports_tests.c, each grouped by
+# ../matrix_ports.awk as the firmware build does. The first cases are the
+# usual wirings, the rest are random pins on the ports B to F.
+#
+#   matrix_ports_cases.sh <random cases> > matrix_ports_cases.h
+
+RANDOM_CASES=${1:-200}
+AWK_SCRIPT=$(dirname "$0")/../matrix_ports.awk
+
+emit_case() {
+    echo "#define CASE_$1_PINS $2"
+    echo "matrix_ports: $2" | awk -v name="CASE_$1_READ" -f "$AWK_SCRIPT" || exit 1
+}
+
+echo "/* Generated by matrix_ports_cases.sh, do not edit */"
+emit_case 0 "{ 0xF1, 0xF0, 0x30, 0x67, 0xF4, 0xF5, 0xF6, 0xF7, 0x94, 0x96, 0x34, 0x97 }"
+emit_case 1 "{ 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97 }"
+emit_case 2 "{ 0x35, 0x34, 0x33, 0x32, 0x31, 0x30 }"
+emit_case 3 "{ 0xF7 }"
+
+cases=4
+while [ $cases -lt $((RANDOM_CASES + 4)) ]; do
+    pins=$(awk -v seed=$cases 'BEGIN {
+        srand(seed)
+        split("3 6 9 12 15", port, " ")
+        count = 1 + int(rand() * 32)
+        list = ""
+        for (n = 0; n < count; ) {
+            code = port[1 + int(rand() * 5)] * 16 + int(rand() * 8)
+            if (code in used) continue
+            used[code] = 1
+            list = list (n ? ", " : "") sprintf("0x%02X", code)
+            n++
+        }
+        print "{ " list " }"
+    }')
+    emit_case $cases "$pins"
+    cases=$((cases + 1))
+done
+
+printf "#define CASE_COUNT %d\n" $cases
+printf "#define FOR_EACH_CASE(X)"
+i=0
+while [ $i -lt $cases ]; do
+    printf " X(%d)" $i
+    i=$((i + 1))
+done
+printf "\n"
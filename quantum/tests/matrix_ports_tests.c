@@ -0,0 +1,88 @@
+#include <cgreen/cgreen.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef uint32_t matrix_row_t;
+
+/* PINx by port code, _SFR_IO8 in the firmware */
+static uint8_t ports[16];
+#define read_port(port) ports[port]
+
+#include "matrix_ports_cases.h"
+
+typedef struct {
+    const uint8_t *pins;
+    uint8_t count;
+    matrix_row_t (*read)(void);
+} read_case_t;
+
+#define DEFINE_CASE(n) \
+    static const uint8_t case_##n##_pins[] = CASE_##n##_PINS; \
+    static matrix_row_t case_##n##_read(void) { \
+        matrix_row_t result = 0; \
+        CASE_##n##_READ(result, read_port); \
+        return result; \
+    }
+FOR_EACH_CASE(DEFINE_CASE)
+
+#define CASE_ENTRY(n) { case_##n##_pins, sizeof(case_##n##_pins), case_##n##_read },
+static const read_case_t cases[] = { FOR_EACH_CASE(CASE_ENTRY) };
+
+// read_cols() as it was, one port read per pin
+static matrix_row_t reference_read(const read_case_t *c) {
+    matrix_row_t result = 0;
+    for (uint8_t x = 0; x < c->count; x++) {
+        uint8_t pin = c->pins[x];
+        result |= (ports[pin >> 4] & (1 << (pin & 0xF))) ? 0 : ((matrix_row_t)1 << x);
+    }
+    return result;
+}
+
+static void set_ports(uint8_t value) {
+    for (uint8_t i = 0; i < sizeof(ports); i++) {
+        ports[i] = value;
+    }
+}
+
+Describe(MatrixPorts);
+BeforeEach(MatrixPorts) {
+    srand(1);
+    set_ports(0xFF);
+}
+AfterEach(MatrixPorts) {}
+
+Ensure(MatrixPorts, reads_nothing_when_no_switch_is_closed) {
+    for (uint16_t i = 0; i < CASE_COUNT; i++) {
+        assert_that(cases[i].read(), is_equal_to(0));
+    }
+}
+
+Ensure(MatrixPorts, reads_every_pin_when_all_switches_are_closed) {
+    set_ports(0);
+    for (uint16_t i = 0; i < CASE_COUNT; i++) {
+        matrix_row_t all = cases[i].count == 32 ? 0xFFFFFFFF : ((matrix_row_t)1 << cases[i].count) - 1;
+        assert_that(cases[i].read(), is_equal_to(all));
+    }
+}
+
+Ensure(MatrixPorts, puts_each_pin_on_its_own_bit) {
+    for (uint16_t i = 0; i < CASE_COUNT; i++) {
+        for (uint8_t x = 0; x < cases[i].count; x++) {
+            uint8_t pin = cases[i].pins[x];
+            set_ports(0xFF);
+            ports[pin >> 4] &= ~(1 << (pin & 0xF));
+            assert_that(cases[i].read(), is_equal_to((matrix_row_t)1 << x));
+        }
+    }
+}
+
+Ensure(MatrixPorts, matches_the_pin_by_pin_read_for_random_switches) {
+    for (uint16_t i = 0; i < CASE_COUNT; i++) {
+        for (uint16_t n = 0; n < 100; n++) {
+            for (uint8_t p = 0; p < sizeof(ports); p++) {
+                ports[p] = rand();
+            }
+            assert_that(cases[i].read(), is_equal_to(reference_read(&cases[i])));
+        }
+    }
+}
@@ -0,0 +1,8 @@
+/* Matrix for the tests that include ../matrix.c, a ROW2COL board */
+#include "config_common.h"
+
+#define MATRIX_ROWS 5
+#define MATRIX_COLS 14
+#define DIODE_DIRECTION ROW2COL
+#define MATRIX_ROW_PINS { D0, D1, D2, D3, D5 }
+#define MATRIX_COL_PINS { F0, F1, F4, F5, F6, F7, B0, B1, B2, B3, B4, B5, B6, B7 }
@@ -0,0 +1,104 @@
+#include <cgreen/cgreen.h>
+#include <stdlib.h>
+#define NO_PRINT
+#include "matrix_test_config.h"
+#include "matrix.c"
+#include "debounce.c"
+#include "util.c"
+
+// Host platform stand-ins, the transpose doesn't touch the pins or the clock
+static uint8_t io[0x40];
+volatile uint8_t *sim_io_register(uint8_t addr) { return &io[addr]; }
+void sim_clock_advance_us(uint32_t us) {}
+uint32_t sim_clock_us(void) { return 0; }
+uint16_t timer_read(void) { return 0; }
+
+// matrix[] from matrix_reversed[] the way matrix_scan() used to build it
+static void reference_transpose(matrix_row_t out[MATRIX_ROWS]) {
+    for (uint8_t y = 0; y < MATRIX_ROWS; y++) {
+        matrix_row_t row = 0;
+        for (uint8_t x = 0; x < MATRIX_COLS; x++) {
+            row |= ((matrix_reversed[x] & (1<<y)) >> y) << x;
+        }
+        out[y] = row;
+    }
+}
+
+static uint32_t random_bits(uint8_t count) {
+    uint32_t bits = ((uint32_t)rand() << 16) ^ rand();
+    return count == 32 ? bits : bits & (((uint32_t)1 << count) - 1);
+}
+
+// Bit c of row r of in is bit r of row c of out
+static bool is_transposed(const uint32_t *in, const uint32_t *out, uint8_t size) {
+    for (uint8_t r = 0; r < size; r++) {
+        for (uint8_t c = 0; c < size; c++) {
+            if (((in[r] >> c) & 1) != ((out[c] >> r) & 1)) return false;
+        }
+    }
+    return true;
+}
+
+Describe(MatrixTranspose);
+BeforeEach(MatrixTranspose) {
+    srand(1);
+    memset(matrix, 0xAA, sizeof(matrix));
+    memset(matrix_reversed, 0, sizeof(matrix_reversed));
+}
+AfterEach(MatrixTranspose) {}
+
+Ensure(MatrixTranspose, transposes_8x8) {
+    for (uint16_t n = 0; n < 1000; n++) {
+        uint8_t bits[8];
+        uint32_t in[8], out[8];
+        for (uint8_t i = 0; i < 8; i++) bits[i] = in[i] = random_bits(8);
+        bittrans(bits);
+        for (uint8_t i = 0; i < 8; i++) out[i] = bits[i];
+        assert_that(is_transposed(in, out, 8), is_true);
+    }
+}
+
+Ensure(MatrixTranspose, transposes_16x16) {
+    for (uint16_t n = 0; n < 1000; n++) {
+        uint16_t bits[16];
+        uint32_t in[16], out[16];
+        for (uint8_t i = 0; i < 16; i++) bits[i] = in[i] = random_bits(16);
+        bittrans16(bits);
+        for (uint8_t i = 0; i < 16; i++) out[i] = bits[i];
+        assert_that(is_transposed(in, out, 16), is_true);
+    }
+}
+
+Ensure(MatrixTranspose, transposes_32x32) {
+    for (uint16_t n = 0; n < 1000; n++) {
+        uint32_t bits[32], in[32];
+        for (uint8_t i = 0; i < 32; i++) bits[i] = in[i] = random_bits(32);
+        bittrans32(bits);
+        assert_that(is_transposed(in, bits, 32), is_true);
+    }
+}
+
+Ensure(MatrixTranspose, puts_every_key_where_the_old_loop_did) {
+    matrix_row_t expected[MATRIX_ROWS];
+    for (uint8_t x = 0; x < MATRIX_COLS; x++) {
+        for (uint8_t y = 0; y < MATRIX_ROWS; y++) {
+            memset(matrix_reversed, 0, sizeof(matrix_reversed));
+            matrix_reversed[x] = 1 << y;
+            matrix_transpose();
+            reference_transpose(expected);
+            assert_that(matrix, is_equal_to_contents_of(expected, sizeof(expected)));
+        }
+    }
+}
+
+Ensure(MatrixTranspose, matches_the_old_loop_for_random_states) {
+    matrix_row_t expected[MATRIX_ROWS];
+    for (uint16_t n = 0; n < 10000; n++) {
+        for (uint8_t x = 0; x < MATRIX_COLS; x++) {
+            matrix_reversed[x] = random_bits(MATRIX_ROWS);
+        }
+        matrix_transpose();
+        reference_transpose(expected);
+        assert_that(matrix, is_equal_to_contents_of(expected, sizeof(expected)));
+    }
+}
@@ -0,0 +1,26 @@
+#include <cgreen/cgreen.h>
+#define RGBLED_NUM 8
+#define RGBLIGHT_TIMER
+// Audio leaves the effects out unless config.h asks for them
+#define AUDIO_ENABLE
+#define RGBLIGHT_EFFECT_SNAKE 1
+#include "rgblight_effects.c"
+#include "rgblight_hsv.c"
+
+Describe(RGBLightEffectsAudio);
+BeforeEach(RGBLightEffectsAudio) {}
+AfterEach(RGBLightEffectsAudio) {}
+
+Ensure(RGBLightEffectsAudio, builds_only_the_effects_config_asks_for) {
+    assert_that(RGBLIGHT_MODES, is_equal_to(1 + 6));
+}
+
+Ensure(RGBLightEffectsAudio, moves_the_asked_for_effect_up) {
+    uint8_t variant;
+    assert_that(rgblight_effect_find(1, &variant), is_null);
+    assert_that(rgblight_effect_find(2, &variant)->step, is_equal_to(snake_step));
+    assert_that(variant, is_equal_to(0));
+    assert_that(rgblight_effect_find(RGBLIGHT_MODES, &variant)->step, is_equal_to(snake_step));
+    assert_that(variant, is_equal_to(5));
+    assert_that(rgblight_effect_find(RGBLIGHT_MODES + 1, &variant), is_null);
+}
@@ -0,0 +1,30 @@
+#include <cgreen/cgreen.h>
+#define RGBLED_NUM 8
+#define RGBLIGHT_TIMER
+// Only some of the effects built in
+#define RGBLIGHT_EFFECT_BREATHING 0
+#define RGBLIGHT_EFFECT_RAINBOW_SWIRL 0
+#include "rgblight_effects.c"
+#include "rgblight_hsv.c"
+
+Describe(RGBLightEffectSelection);
+BeforeEach(RGBLightEffectSelection) {}
+AfterEach(RGBLightEffectSelection) {}
+
+Ensure(RGBLightEffectSelection, counts_only_the_modes_of_the_built_effects) {
+    assert_that(RGBLIGHT_MODES, is_equal_to(1 + 3 + 6 + 3));
+}
+
+Ensure(RGBLightEffectSelection, moves_the_other_effects_up) {
+    uint8_t variant;
+    assert_that(rgblight_effect_find(1, &variant), is_null);
+    assert_that(rgblight_effect_find(2, &variant)->step, is_equal_to(rainbow_mood_step));
+    assert_that(variant, is_equal_to(0));
+    assert_that(rgblight_effect_find(5, &variant)->step, is_equal_to(snake_step));
+    assert_that(variant, is_equal_to(0));
+    assert_that(rgblight_effect_find(11, &variant)->step, is_equal_to(knight_step));
+    assert_that(variant, is_equal_to(0));
+    assert_that(rgblight_effect_find(RGBLIGHT_MODES, &variant)->step, is_equal_to(knight_step));
+    assert_that(variant, is_equal_to(2));
+    assert_that(rgblight_effect_find(RGBLIGHT_MODES + 1, &variant), is_null);
+}
@@ -0,0 +1,214 @@
+#include <cgreen/cgreen.h>
+#include <stdio.h>
+#define RGBLED_NUM 8
+#define RGBLIGHT_TIMER
+#define RGBLIGHT_EFFECT_SNAKE_LENGTH 3
+#define RGBLIGHT_EFFECT_KNIGHT_LENGTH 3
+#include "rgblight_effects.c"
+#include "rgblight_hsv.c"
+
+// Frames recorded from the effects as they were before the registry, on 8
+// LEDs with hue 200, sat 204 and val 204
+typedef struct {
+    uint16_t frame;
+    const char *leds;
+} frame_t;
+
+static const frame_t breathing_0[] = {
+    {0, "000000 000000 000000 000000 000000 000000 000000 000000"},
+    {40, "000407 000407 000407 000407 000407 000407 000407 000407"},
+    {64, "00111a 00111a 00111a 00111a 00111a 00111a 00111a 00111a"},
+    {100, "036597 036597 036597 036597 036597 036597 036597 036597"},
+    {128, "05abff 05abff 05abff 05abff 05abff 05abff 05abff 05abff"},
+    {200, "000b11 000b11 000b11 000b11 000b11 000b11 000b11 000b11"},
+};
+
+static const frame_t rainbow_mood_0[] = {
+    {0, "670202 670202 670202 670202 670202 670202 670202 670202"},
+    {1, "670302 670302 670302 670302 670302 670302 670302 670302"},
+    {59, "676502 676502 676502 676502 676502 676502 676502 676502"},
+    {60, "676702 676702 676702 676702 676702 676702 676702 676702"},
+    {200, "024567 024567 024567 024567 024567 024567 024567 024567"},
+    {359, "670203 670203 670203 670203 670203 670203 670203 670203"},
+    {360, "670202 670202 670202 670202 670202 670202 670202 670202"},
+};
+
+static const frame_t rainbow_swirl_0[] = {
+    {0, "670202 674d02 346702 02671b 026767 021b67 340267 67024d"},
+    {1, "670203 674c02 366702 026719 026765 021c67 320267 67024f"},
+    {2, "670205 674a02 376702 026717 026763 021e67 310267 670251"},
+    {45, "67024d 670202 674d02 346702 02671b 026767 021b67 340267"},
+    {100, "230267 67025e 670212 673c02 456702 02670a 026756 022c67"},
+};
+
+static const frame_t rainbow_swirl_1[] = {
+    {0, "670202 674d02 346702 02671b 026767 021b67 340267 67024d"},
+    {1, "670302 674f02 326702 02671c 026567 021967 360267 67024c"},
+    {2, "670502 675102 316702 02671e 026367 021767 370267 67024a"},
+    {45, "674d02 346702 02671b 026767 021b67 340267 67024d 670202"},
+    {100, "236702 02672c 025667 020a67 450267 67023c 671202 675e02"},
+};
+
+static const frame_t snake_0[] = {
+    {0, "024567 00141f 000609 000000 000000 000000 000000 000000"},
+    {1, "000000 000000 000000 000000 000000 000000 000000 024567"},
+    {2, "000000 000000 000000 000000 000000 000000 024567 00141f"},
+    {3, "000000 000000 000000 000000 000000 024567 00141f 000609"},
+    {4, "000000 000000 000000 000000 024567 00141f 000609 000000"},
+    {5, "000000 000000 000000 024567 00141f 000609 000000 000000"},
+    {6, "000000 000000 024567 00141f 000609 000000 000000 000000"},
+    {7, "000000 024567 00141f 000609 000000 000000 000000 000000"},
+    {8, "024567 00141f 000609 000000 000000 000000 000000 000000"},
+    {9, "000000 000000 000000 000000 000000 000000 000000 024567"},
+};
+
+static const frame_t snake_1[] = {
+    {0, "024567 000000 000000 000000 000000 000000 000609 00141f"},
+    {1, "00141f 024567 000000 000000 000000 000000 000000 000609"},
+    {2, "000609 00141f 024567 000000 000000 000000 000000 000000"},
+    {3, "000000 000609 00141f 024567 000000 000000 000000 000000"},
+    {4, "000000 000000 000609 00141f 024567 000000 000000 000000"},
+    {5, "000000 000000 000000 000609 00141f 024567 000000 000000"},
+    {6, "000000 000000 000000 000000 000609 00141f 024567 000000"},
+    {7, "000000 000000 000000 000000 000000 000609 00141f 024567"},
+    {8, "024567 000000 000000 000000 000000 000000 000609 00141f"},
+    {9, "00141f 024567 000000 000000 000000 000000 000000 000609"},
+};
+
+static const frame_t knight_0[] = {
+    {0, "000000 000000 000000 000000 000000 000000 000000 024567"},
+    {1, "024567 000000 000000 000000 000000 000000 000000 024567"},
+    {2, "024567 024567 000000 000000 000000 000000 000000 024567"},
+    {3, "024567 024567 024567 000000 000000 000000 000000 000000"},
+    {4, "000000 024567 024567 024567 000000 000000 000000 000000"},
+    {5, "000000 000000 024567 024567 024567 000000 000000 000000"},
+    {6, "000000 000000 000000 024567 024567 024567 000000 000000"},
+    {7, "000000 000000 000000 000000 024567 024567 024567 000000"},
+    {8, "000000 000000 000000 000000 000000 024567 024567 000000"},
+    {9, "000000 000000 000000 000000 000000 000000 024567 000000"},
+    {10, "000000 000000 000000 000000 000000 000000 024567 000000"},
+    {11, "000000 000000 000000 000000 000000 000000 024567 000000"},
+    {12, "000000 000000 000000 000000 000000 000000 024567 000000"},
+    {13, "000000 000000 000000 000000 000000 000000 024567 000000"},
+    {14, "000000 000000 000000 000000 000000 000000 024567 000000"},
+    {15, "000000 000000 000000 000000 000000 000000 024567 000000"},
+    {16, "000000 000000 000000 000000 000000 024567 024567 000000"},
+    {17, "000000 000000 000000 000000 024567 024567 024567 000000"},
+    {18, "000000 000000 000000 024567 024567 024567 000000 000000"},
+    {19, "000000 000000 024567 024567 024567 000000 000000 000000"},
+};
+
+#define FRAMES(table) table, sizeof(table) / sizeof(table[0])
+
+static rgblight_config_t config;
+static rgblight_effect_state_t state;
+static struct cRGB leds[RGBLED_NUM];
+static char text[RGBLED_NUM * 7];
+
+Describe(RGBLightEffects);
+BeforeEach(RGBLightEffects) {
+    config.raw = 0;
+    config.enable = 1;
+    config.hue = 200;
+    config.sat = 204;
+    config.val = 204;
+    memset(&state, 0xAA, sizeof(state));
+    memset(leds, 0xAA, sizeof(leds));
+}
+AfterEach(RGBLightEffects) {}
+
+static const char *format_leds(void) {
+    char *out = text;
+    for (uint8_t i = 0; i < RGBLED_NUM; i++) {
+        out += sprintf(out, i ? " %02x%02x%02x" : "%02x%02x%02x", leds[i].r, leds[i].g, leds[i].b);
+    }
+    return text;
+}
+
+// Steps the effect of mode from its first frame and compares the frames
+// that were recorded
+static void assert_frames(uint8_t mode, const frame_t *frames, uint8_t count) {
+    uint8_t variant;
+    const rgblight_effect_t *effect = rgblight_effect_find(mode, &variant);
+    assert_that(effect, is_non_null);
+    effect->init(&state, variant);
+    uint16_t frame = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        for (; frame <= frames[i].frame; frame++) {
+            effect->step(&state, variant, &config, leds);
+        }
+        assert_that(format_leds(), is_equal_to_string(frames[i].leds));
+    }
+}
+
+Ensure(RGBLightEffects, the_static_mode_has_no_effect) {
+    uint8_t variant;
+    assert_that(rgblight_effect_find(0, &variant), is_null);
+    assert_that(rgblight_effect_find(1, &variant), is_null);
+}
+
+Ensure(RGBLightEffects, maps_the_modes_to_the_effects_in_order) {
+    uint8_t variant;
+    assert_that(rgblight_effect_find(2, &variant)->step, is_equal_to(breathing_step));
+    assert_that(variant, is_equal_to(0));
+    assert_that(rgblight_effect_find(5, &variant)->step, is_equal_to(breathing_step));
+    assert_that(variant, is_equal_to(3));
+    assert_that(rgblight_effect_find(6, &variant)->step, is_equal_to(rainbow_mood_step));
+    assert_that(rgblight_effect_find(9, &variant)->step, is_equal_to(rainbow_swirl_step));
+    assert_that(rgblight_effect_find(15, &variant)->step, is_equal_to(snake_step));
+    assert_that(rgblight_effect_find(21, &variant)->step, is_equal_to(knight_step));
+    assert_that(rgblight_effect_find(23, &variant)->step, is_equal_to(knight_step));
+    assert_that(variant, is_equal_to(2));
+    assert_that(rgblight_effect_find(RGBLIGHT_MODES + 1, &variant), is_null);
+}
+
+Ensure(RGBLightEffects, keeps_the_hue_or_val_the_effect_animates) {
+    uint8_t variant;
+    assert_that(rgblight_effect_find(2, &variant)->flags, is_equal_to(RGBLIGHT_FLAG_KEEP_VAL));
+    assert_that(rgblight_effect_find(6, &variant)->flags, is_equal_to(RGBLIGHT_FLAG_KEEP_HUE));
+    assert_that(rgblight_effect_find(9, &variant)->flags, is_equal_to(RGBLIGHT_FLAG_KEEP_HUE));
+    assert_that(rgblight_effect_find(15, &variant)->flags, is_equal_to(0));
+    assert_that(rgblight_effect_find(21, &variant)->flags, is_equal_to(0));
+}
+
+Ensure(RGBLightEffects, returns_the_interval_of_the_variant) {
+    static const uint8_t modes[] = {2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23};
+    static const uint16_t intervals[] = {30, 20, 10, 5, 120, 60, 30, 100, 100, 50, 50, 20, 20, 100, 100, 50, 50, 20, 20, 100, 50, 20};
+    for (uint8_t i = 0; i < sizeof(modes); i++) {
+        uint8_t variant;
+        const rgblight_effect_t *effect = rgblight_effect_find(modes[i], &variant);
+        effect->init(&state, variant);
+        assert_that(effect->step(&state, variant, &config, leds), is_equal_to(intervals[i]));
+    }
+}
+
+Ensure(RGBLightEffects, draws_breathing_as_before) {
+    assert_frames(2, FRAMES(breathing_0));
+}
+
+Ensure(RGBLightEffects, draws_rainbow_mood_as_before) {
+    assert_frames(6, FRAMES(rainbow_mood_0));
+}
+
+Ensure(RGBLightEffects, draws_rainbow_swirl_as_before) {
+    assert_frames(9, FRAMES(rainbow_swirl_0));
+    assert_frames(10, FRAMES(rainbow_swirl_1));
+}
+
+Ensure(RGBLightEffects, draws_snake_as_before) {
+    assert_frames(15, FRAMES(snake_0));
+    assert_frames(16, FRAMES(snake_1));
+}
+
+Ensure(RGBLightEffects, draws_knight_as_before) {
+    assert_frames(21, FRAMES(knight_0));
+}
+
+Ensure(RGBLightEffects, restarts_the_effect_on_init) {
+    uint8_t variant;
+    const rgblight_effect_t *effect = rgblight_effect_find(15, &variant);
+    effect->init(&state, variant);
+    effect->step(&state, variant, &config, leds);
+    effect->step(&state, variant, &config, leds);
+    assert_frames(15, FRAMES(snake_0));
+}
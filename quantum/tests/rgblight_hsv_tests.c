@@ -0,0 +1,109 @@
+#include <cgreen/cgreen.h>
+#include "rgblight_hsv.c"
+#include "hsv_reference.h"
+
+#define NUM_LEDS 14
+
+Describe(RGBLightHSV);
+BeforeEach(RGBLightHSV) {}
+AfterEach(RGBLightHSV) {}
+
+static bool same_color(struct cRGB a, struct cRGB b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+Ensure(RGBLightHSV, converts_red_green_and_blue) {
+    struct cRGB led;
+    sethsv(0, 255, 255, &led);
+    assert_that(led.r, is_equal_to(255));
+    assert_that(led.g, is_equal_to(0));
+    assert_that(led.b, is_equal_to(0));
+    sethsv(120, 255, 255, &led);
+    assert_that(led.r, is_equal_to(0));
+    assert_that(led.g, is_equal_to(255));
+    assert_that(led.b, is_equal_to(0));
+    sethsv(240, 255, 255, &led);
+    assert_that(led.r, is_equal_to(0));
+    assert_that(led.g, is_equal_to(0));
+    assert_that(led.b, is_equal_to(255));
+}
+
+Ensure(RGBLightHSV, converts_gray_regardless_of_hue) {
+    struct cRGB led;
+    sethsv(77, 0, 255, &led);
+    assert_that(led.r, is_equal_to(255));
+    assert_that(led.g, is_equal_to(255));
+    assert_that(led.b, is_equal_to(255));
+}
+
+Ensure(RGBLightHSV, sethsv_matches_the_division_based_conversion) {
+    unsigned mismatches = 0;
+    for (uint16_t hue = 0; hue < 360; hue++) {
+        for (uint16_t sat = 0; sat < 256; sat++) {
+            for (uint16_t val = 0; val < 256; val++) {
+                struct cRGB expected, actual;
+                reference_sethsv(hue, sat, val, &expected);
+                sethsv(hue, sat, val, &actual);
+                if (!same_color(expected, actual)) {
+                    mismatches++;
+                }
+            }
+        }
+    }
+    assert_that(mismatches, is_equal_to(0));
+}
+
+Ensure(RGBLightHSV, the_palette_matches_the_division_based_conversion) {
+    unsigned mismatches = 0;
+    hsv_palette_t palette = {.valid = false};
+    for (uint16_t sat = 0; sat < 256; sat++) {
+        for (uint16_t val = 0; val < 256; val++) {
+            hsv_palette_update(&palette, sat, val);
+            for (uint16_t hue = 0; hue < 360; hue++) {
+                struct cRGB expected, actual;
+                reference_sethsv(hue, sat, val, &expected);
+                hsv_palette_get(&palette, hue, &actual);
+                if (!same_color(expected, actual)) {
+                    mismatches++;
+                }
+            }
+        }
+    }
+    assert_that(mismatches, is_equal_to(0));
+}
+
+Ensure(RGBLightHSV, only_rebuilds_the_palette_when_sat_or_val_change) {
+    hsv_palette_t palette = {.valid = false};
+    hsv_palette_update(&palette, 200, 100);
+    palette.ramp[30] = 0x5A;
+    hsv_palette_update(&palette, 200, 100);
+    assert_that(palette.ramp[30], is_equal_to(0x5A));
+    hsv_palette_update(&palette, 200, 101);
+    assert_that(palette.ramp[30], is_not_equal_to(0x5A));
+}
+
+Ensure(RGBLightHSV, renders_a_rainbow_like_the_per_led_conversion) {
+    hsv_palette_t palette = {.valid = false};
+    hsv_palette_update(&palette, 255, 255);
+    for (uint16_t start = 0; start < 360; start++) {
+        struct cRGB leds[NUM_LEDS];
+        hsv_palette_render(&palette, start, 360 / NUM_LEDS, leds, NUM_LEDS);
+        for (uint8_t i = 0; i < NUM_LEDS; i++) {
+            struct cRGB expected;
+            reference_sethsv((360 / NUM_LEDS * i + start) % 360, 255, 255, &expected);
+            assert_that(same_color(leds[i], expected), is_true);
+        }
+    }
+}
+
+Ensure(RGBLightHSV, renders_with_steps_over_one_sector) {
+    hsv_palette_t palette = {.valid = false};
+    hsv_palette_update(&palette, 180, 220);
+    struct cRGB leds[NUM_LEDS];
+    hsv_palette_render(&palette, 350, 137, leds, NUM_LEDS);
+    for (uint8_t i = 0; i < NUM_LEDS; i++) {
+        struct cRGB expected;
+        reference_sethsv((350 + 137 * i) % 360, 180, 220, &expected);
+        assert_that(same_color(leds[i], expected), is_true);
+    }
+}
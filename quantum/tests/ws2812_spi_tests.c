@@ -0,0 +1,73 @@
+#include <cgreen/cgreen.h>
+#include "ws2812_spi.h"
+#include "ws2812_spi.c"
+
+#define NUM_LEDS 4
+
+static uint8_t out[WS2812_SPI_FRAME_SIZE(NUM_LEDS) + 1];
+
+Describe(WS2812SPI);
+BeforeEach(WS2812SPI) {
+    memset(out, 0xAA, sizeof(out));
+}
+AfterEach(WS2812SPI) {}
+
+// Reads the bit at position bit of the SPI stream, MSB first
+static uint8_t stream_bit(uint16_t bit) {
+    return (out[bit / 8] >> (7 - bit % 8)) & 1;
+}
+
+Ensure(WS2812SPI, encodes_a_zero_byte_as_short_pulses) {
+    struct cRGB led = {.g = 0, .r = 0, .b = 0};
+    ws2812_spi_encode(&led, 1, out);
+    uint8_t expected[] = {0x92, 0x49, 0x24};
+    assert_that(out, is_equal_to_contents_of(expected, 3));
+}
+
+Ensure(WS2812SPI, encodes_an_FF_byte_as_long_pulses) {
+    struct cRGB led = {.g = 0xFF, .r = 0, .b = 0};
+    ws2812_spi_encode(&led, 1, out);
+    uint8_t expected[] = {0xDB, 0x6D, 0xB6};
+    assert_that(out, is_equal_to_contents_of(expected, 3));
+}
+
+Ensure(WS2812SPI, sends_the_most_significant_bit_first) {
+    struct cRGB led = {.g = 0x80, .r = 0x01, .b = 0};
+    ws2812_spi_encode(&led, 1, out);
+    uint8_t expected[] = {0xD2, 0x49, 0x24, 0x92, 0x49, 0x26};
+    assert_that(out, is_equal_to_contents_of(expected, 6));
+}
+
+Ensure(WS2812SPI, sends_green_red_blue) {
+    struct cRGB led = {.g = 0xFF, .r = 0x00, .b = 0xFF};
+    ws2812_spi_encode(&led, 1, out);
+    uint8_t expected[] = {0xDB, 0x6D, 0xB6, 0x92, 0x49, 0x24, 0xDB, 0x6D, 0xB6};
+    assert_that(out, is_equal_to_contents_of(expected, 9));
+}
+
+Ensure(WS2812SPI, ends_the_frame_with_the_reset) {
+    struct cRGB leds[NUM_LEDS] = {{0xFF, 0xFF, 0xFF}, {0xFF, 0xFF, 0xFF}, {0xFF, 0xFF, 0xFF}, {0xFF, 0xFF, 0xFF}};
+    uint16_t size = ws2812_spi_encode(leds, NUM_LEDS, out);
+    assert_that(size, is_equal_to(WS2812_SPI_FRAME_SIZE(NUM_LEDS)));
+    uint8_t zeros[WS2812_SPI_RESET_SIZE] = {0};
+    assert_that(out + NUM_LEDS * WS2812_SPI_LED_SIZE, is_equal_to_contents_of(zeros, WS2812_SPI_RESET_SIZE));
+    // Nothing written past the end
+    assert_that(out[size], is_equal_to(0xAA));
+}
+
+Ensure(WS2812SPI, holds_the_line_low_for_the_reset_time) {
+    // 2.4 bits per microsecond
+    assert_that(WS2812_SPI_RESET_SIZE * 8 * 10 / 24, is_greater_than(WS2812_RESET_US - 1));
+}
+
+Ensure(WS2812SPI, every_bit_is_a_pulse_with_the_data_in_the_middle) {
+    struct cRGB leds[NUM_LEDS] = {{0x12, 0x34, 0x56}, {0x78, 0x9A, 0xBC}, {0xDE, 0xF0, 0x0F}, {0xA5, 0x5A, 0xC3}};
+    ws2812_spi_encode(leds, NUM_LEDS, out);
+    const uint8_t* data = (const uint8_t*)leds;
+    for (uint16_t i = 0; i < NUM_LEDS * 3 * 8; i++) {
+        uint8_t expected = (data[i / 8] >> (7 - i % 8)) & 1;
+        assert_that(stream_bit(i * 3), is_equal_to(1));
+        assert_that(stream_bit(i * 3 + 1), is_equal_to(expected));
+        assert_that(stream_bit(i * 3 + 2), is_equal_to(0));
+    }
+}
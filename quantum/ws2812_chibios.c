@@ -0,0 +1,90 @@
+/*
+ * WS2812 output on ChibiOS, the SPI encoding from ws2812_spi.c streamed to
+ * MOSI by DMA.
+ *
+ * The keyboard's config.h sets WS2812_SPI_CONFIG to an SPIConfig
+ * initializer for a 2.4 MHz clock and 8 bit frames on WS2812_SPI_DRIVER,
+ * and routes MOSI of that SPI to the data in of the first LED. Only MOSI is
+ * used, no chip select.
+ *
+ * There are two frame buffers. A new frame is encoded into the one that is
+ * not being sent, and sent as soon as the previous transfer completes.
+ * Frames that are replaced before that are never sent, so the frame that
+ * replaces one covers at least as many LEDs as it did.
+ */
+
+#include "ch.h"
+#include "hal.h"
+#include "rgblight.h"
+
+#ifndef WS2812_SPI_DRIVER
+#define WS2812_SPI_DRIVER SPID1
+#endif
+
+#ifndef WS2812_SPI_CONFIG
+#error "Set WS2812_SPI_CONFIG to an SPIConfig for a 2.4 MHz clock in config.h"
+#endif
+
+static uint8_t frames[2][WS2812_SPI_FRAME_SIZE(RGBLED_NUM)];
+static uint16_t frame_size[2];
+// The frame the DMA reads, or read last
+static uint8_t front = 0;
+// The back frame is complete and waits for the transfer to finish
+static volatile bool pending = false;
+// The LEDs in the back frame while it is pending
+static uint16_t pending_leds;
+static bool started = false;
+
+static SPIConfig config = WS2812_SPI_CONFIG;
+
+static void start_back_i(SPIDriver *spip) {
+  front ^= 1;
+  pending = false;
+  spiStartSendI(spip, frame_size[front], frames[front]);
+}
+
+static void transfer_done(SPIDriver *spip) {
+  if (pending) {
+    chSysLockFromISR();
+    start_back_i(spip);
+    chSysUnlockFromISR();
+  }
+}
+
+static void ws2812_init(void) {
+  config.end_cb = transfer_done;
+  spiStart(&WS2812_SPI_DRIVER, &config);
+  started = true;
+}
+
+void ws2812_setleds(struct cRGB *ledarray, uint16_t number_of_leds) {
+  if (!started) {
+    ws2812_init();
+  }
+  if (number_of_leds > RGBLED_NUM) {
+    number_of_leds = RGBLED_NUM;
+  }
+
+  // Take the back frame out of the callback's hands while encoding. If
+  // it was never sent, send its LEDs with this frame, ledarray holds them
+  chSysLock();
+  if (pending) {
+    pending = false;
+    if (pending_leds > number_of_leds) {
+      number_of_leds = pending_leds;
+    }
+  }
+  chSysUnlock();
+
+  uint8_t back = front ^ 1;
+  frame_size[back] = ws2812_spi_encode(ledarray, number_of_leds, frames[back]);
+
+  chSysLock();
+  if (WS2812_SPI_DRIVER.state == SPI_READY) {
+    start_back_i(&WS2812_SPI_DRIVER);
+  } else {
+    pending = true;
+    pending_leds = number_of_leds;
+  }
+  chSysUnlock();
+}
@@ -0,0 +1,34 @@
+#include "ws2812_spi.h"
+
+// Spreads the bits of a colour byte into 24 bits of 1x0 patterns, MSB
+// first
+static uint32_t encode_byte(uint8_t value) {
+  uint32_t pattern = 0;
+  for (uint8_t i = 0; i < 8; ++i) {
+    pattern <<= 3;
+    pattern |= (value & 0x80) ? 6 : 4;
+    value <<= 1;
+  }
+  return pattern;
+}
+
+static uint8_t* put_byte(uint8_t value, uint8_t *out) {
+  uint32_t pattern = encode_byte(value);
+  *out++ = pattern >> 16;
+  *out++ = pattern >> 8;
+  *out++ = pattern;
+  return out;
+}
+
+uint16_t ws2812_spi_encode(const struct cRGB *ledarray, uint16_t number_of_leds, uint8_t *out) {
+  uint8_t *start = out;
+  for (uint16_t i = 0; i < number_of_leds; ++i) {
+    out = put_byte(ledarray[i].g, out);
+    out = put_byte(ledarray[i].r, out);
+    out = put_byte(ledarray[i].b, out);
+  }
+  for (uint16_t i = 0; i < WS2812_SPI_RESET_SIZE; ++i) {
+    *out++ = 0;
+  }
+  return out - start;
+}
@@ -0,0 +1,42 @@
+/*
+ * WS2812 through an SPI peripheral, for targets that can't bit-bang.
+ *
+ * Every bit for the LEDs becomes three bits on MOSI, 100 for a 0 and 110
+ * for a 1. With the SPI clocked at 2.4 MHz a high pulse is 417 ns or
+ * 833 ns out of 1.25 us, which is within the WS2812 timing. One colour
+ * byte takes three SPI bytes, and the frame ends with enough zero bytes to
+ * hold the line low for the reset, so the LEDs have latched by the time
+ * the transfer completes.
+ */
+
+#ifndef WS2812_SPI_H_
+#define WS2812_SPI_H_
+
+#include <stdint.h>
+
+struct cRGB  { uint8_t g; uint8_t r; uint8_t b; };
+
+// SPI bytes for each LED
+#define WS2812_SPI_LED_SIZE 9
+
+// How long the line stays low after a frame, at least 50 us for the
+// WS2812B, some newer parts need 280 us
+#ifndef WS2812_RESET_US
+#define WS2812_RESET_US 60
+#endif
+
+// The reset in SPI bytes at 2.4 MHz
+#define WS2812_SPI_RESET_SIZE ((WS2812_RESET_US * 24 / 10 + 7) / 8)
+
+#define WS2812_SPI_FRAME_SIZE(leds) ((leds) * WS2812_SPI_LED_SIZE + WS2812_SPI_RESET_SIZE)
+
+// Encodes the LEDs in GRB order followed by the reset into out, which must
+// hold WS2812_SPI_FRAME_SIZE(number_of_leds) bytes. Returns the bytes used.
+uint16_t ws2812_spi_encode(const struct cRGB *ledarray, uint16_t number_of_leds, uint8_t *out);
+
+// Starts sending the LEDs and returns without waiting for the transfer.
+// A frame that replaces one not sent yet takes the LEDs of both from
+// ledarray, so it has to hold the whole strip, not only the changed part.
+void ws2812_setleds(struct cRGB *ledarray, uint16_t number_of_leds);
+
+#endif /* WS2812_SPI_H_ */
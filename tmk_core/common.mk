@@ -3,6 +3,8 @@ ifeq ($(PLATFORM),AVR)
 	PLATFORM_COMMON_DIR = $(COMMON_DIR)/avr
 else ifeq ($(PLATFORM),CHIBIOS)
 	PLATFORM_COMMON_DIR = $(COMMON_DIR)/chibios
+else ifeq ($(PLATFORM),HOST)
+	PLATFORM_COMMON_DIR = $(COMMON_DIR)/host
 endif
 
 SRC +=	$(COMMON_DIR)/host.c \
@@ -29,6 +31,11 @@ ifeq ($(PLATFORM),CHIBIOS)
 	SRC += $(PLATFORM_COMMON_DIR)/eeprom.c
 endif
 
+ifeq ($(PLATFORM),HOST)
+	SRC += $(PLATFORM_COMMON_DIR)/eeprom.c
+	SRC += $(PLATFORM_COMMON_DIR)/io.c
+endif
+
 
 
 # Option modules
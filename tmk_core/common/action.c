@@ -78,10 +78,11 @@ void process_record(keyrecord_t *record)
 {
     if (IS_NOEVENT(record->event)) { return; }
 
+    layer_switch_resolve(record);
     if(!process_record_quantum(record))
         return;
 
-    action_t action = store_or_get_action(record->event.pressed, record->event.key);
+    action_t action = record->action;
     dprint("ACTION: "); debug_action(action);
 #ifndef NO_ACTION_LAYER
     dprint(" layer_state: "); layer_debug();
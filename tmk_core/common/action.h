@@ -44,6 +44,11 @@ typedef struct {
 #ifndef NO_ACTION_TAPPING
     tap_t tap;
 #endif
+    /* the key resolved through the layers, filled once by process_record */
+    bool        resolved;
+    uint8_t     layer;
+    uint16_t    keycode;
+    action_t    action;
 } keyrecord_t;
 
 /* Execute action per keyevent */
@@ -51,6 +56,8 @@ void action_exec(keyevent_t event);
 
 /* action for key */
 action_t action_for_key(uint8_t layer, keypos_t key);
+/* action for keycode */
+action_t action_for_keycode(uint16_t keycode);
 
 /* macro */
 const macro_t *action_get_macro(keyrecord_t *record, uint8_t id, uint8_t opt);
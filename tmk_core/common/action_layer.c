@@ -1,8 +1,10 @@
 #include <stdint.h>
+#include <string.h>
 #include "keyboard.h"
 #include "action.h"
 #include "util.h"
 #include "action_layer.h"
+#include "keymap.h"
 
 #ifdef DEBUG_ACTION
 #include "debug.h"
@@ -27,7 +29,7 @@ static void default_layer_state_set(uint32_t state)
 
 void default_layer_debug(void)
 {
-    dprintf("%08lX(%u)", default_layer_state, biton32(default_layer_state));
+    dprintf("%08lX(%u)", (unsigned long)default_layer_state, biton32(default_layer_state));
 }
 
 void default_layer_set(uint32_t state)
@@ -106,7 +108,7 @@ void layer_xor(uint32_t state)
 
 void layer_debug(void)
 {
-    dprintf("%08lX(%u)", layer_state, biton32(layer_state));
+    dprintf("%08lX(%u)", (unsigned long)layer_state, biton32(layer_state));
 }
 #endif
 
@@ -145,17 +147,48 @@ uint8_t read_source_layers_cache(keypos_t key)
 }
 #endif
 
+#if !defined(NO_ACTION_LAYER) && defined(LAYER_LOOKUP_CACHE)
+/*
+ * Topmost non-transparent layer of each key for the layer state in
+ * layer_cache_state. Entries are filled on first lookup and the whole
+ * cache is dropped when the layer state differs, so direct writes to
+ * layer_state are picked up as well.
+ */
+#define LAYER_CACHE_EMPTY 0xFF
+static uint8_t layer_cache[MATRIX_ROWS][MATRIX_COLS];
+static uint32_t layer_cache_state;
+static bool layer_cache_valid = false;
+
+void layer_cache_clear(void)
+{
+    layer_cache_valid = false;
+}
+
+static uint8_t *layer_cache_entry(keypos_t key, uint32_t layers)
+{
+    if (key.row >= MATRIX_ROWS || key.col >= MATRIX_COLS) {
+        return NULL;
+    }
+    if (!layer_cache_valid || layer_cache_state != layers) {
+        memset(layer_cache, LAYER_CACHE_EMPTY, sizeof(layer_cache));
+        layer_cache_state = layers;
+        layer_cache_valid = true;
+    }
+    return &layer_cache[key.row][key.col];
+}
+#endif
+
 /*
  * Make sure the action triggered when the key is released is the same
  * one as the one triggered on press. It's important for the mod keys
  * when the layer is switched after the down event but before the up
  * event as they may get stuck otherwise.
  */
-action_t store_or_get_action(bool pressed, keypos_t key)
+static uint8_t store_or_get_layer(bool pressed, keypos_t key)
 {
 #if !defined(NO_ACTION_LAYER) && defined(PREVENT_STUCK_MODIFIERS)
     if (disable_action_cache) {
-        return layer_switch_get_action(key);
+        return layer_switch_get_layer(key);
     }
 
     uint8_t layer;
@@ -167,12 +200,33 @@ action_t store_or_get_action(bool pressed, keypos_t key)
     else {
         layer = read_source_layers_cache(key);
     }
-    return action_for_key(layer, key);
+    return layer;
 #else
-    return layer_switch_get_action(key);
+    return layer_switch_get_layer(key);
 #endif
 }
 
+action_t store_or_get_action(bool pressed, keypos_t key)
+{
+    return action_for_key(store_or_get_layer(pressed, key), key);
+}
+
+/*
+ * Resolve layer, keycode and action of a record once, when it is
+ * processed. Every later stage reads them from the record, so the
+ * action run is always the one of the keycode the hooks were given.
+ */
+void layer_switch_resolve(keyrecord_t *record)
+{
+    if (record->resolved) {
+        return;
+    }
+    record->layer = store_or_get_layer(record->event.pressed, record->event.key);
+    record->keycode = keymap_key_to_keycode(record->layer, record->event.key);
+    record->action = action_for_keycode(record->keycode);
+    record->resolved = true;
+}
+
 
 int8_t layer_switch_get_layer(keypos_t key)
 {
@@ -181,17 +235,30 @@ int8_t layer_switch_get_layer(keypos_t key)
 
 #ifndef NO_ACTION_LAYER
     uint32_t layers = layer_state | default_layer_state;
+#ifdef LAYER_LOOKUP_CACHE
+    uint8_t *cached = layer_cache_entry(key, layers);
+    if (cached && *cached != LAYER_CACHE_EMPTY) {
+        return *cached;
+    }
+#endif
+    int8_t layer = 0;
     /* check top layer first */
     for (int8_t i = 31; i >= 0; i--) {
         if (layers & (1UL<<i)) {
             action = action_for_key(i, key);
             if (action.code != ACTION_TRANSPARENT) {
-                return i;
+                layer = i;
+                break;
             }
         }
     }
-    /* fall back to layer 0 */
-    return 0;
+    /* falls back to layer 0 */
+#ifdef LAYER_LOOKUP_CACHE
+    if (cached) {
+        *cached = layer;
+    }
+#endif
+    return layer;
 #else
     return biton32(default_layer_state);
 #endif
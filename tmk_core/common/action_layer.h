@@ -79,6 +79,14 @@ void update_source_layers_cache(keypos_t key, uint8_t layer);
 uint8_t read_source_layers_cache(keypos_t key);
 #endif
 action_t store_or_get_action(bool pressed, keypos_t key);
+/* fill layer, keycode and action of the record unless already done */
+void layer_switch_resolve(keyrecord_t *record);
+
+/* resolved layer per key cache */
+#if !defined(NO_ACTION_LAYER) && defined(LAYER_LOOKUP_CACHE)
+/* call when the keymap itself changes, layer state changes are detected */
+void layer_cache_clear(void);
+#endif
 
 /* return the topmost non-transparent layer currently associated with key */
 int8_t layer_switch_get_layer(keypos_t key);
@@ -20,14 +20,24 @@
 #define IS_TAPPING_KEY(k)       (IS_TAPPING() && KEYEQ(tapping_key.event.key, (k)))
 #define WITHIN_TAPPING_TERM(e)  (TIMER_DIFF_16(e.time, tapping_key.event.time) < TAPPING_TERM)
 
+#if WAITING_BUFFER_SIZE < 2 || WAITING_BUFFER_SIZE > 128 || (WAITING_BUFFER_SIZE & (WAITING_BUFFER_SIZE - 1))
+#   error "WAITING_BUFFER_SIZE must be a power of two from 2 to 128"
+#endif
+#define WAITING_BUFFER_NEXT(i)  (((i) + 1) & (WAITING_BUFFER_SIZE - 1))
+#define WAITING_BUFFER_COUNT()  ((waiting_buffer_head - waiting_buffer_tail) & (WAITING_BUFFER_SIZE - 1))
+
 
 static keyrecord_t tapping_key = {};
 static keyrecord_t waiting_buffer[WAITING_BUFFER_SIZE] = {};
 static uint8_t waiting_buffer_head = 0;
 static uint8_t waiting_buffer_tail = 0;
+static uint8_t waiting_buffer_high_water = 0;
+static uint16_t waiting_buffer_overflows = 0;
 
 static bool process_tapping(keyrecord_t *record);
 static bool waiting_buffer_enq(keyrecord_t record);
+static void waiting_buffer_process(void);
+static void waiting_buffer_settle(void);
 static void waiting_buffer_clear(void);
 static bool waiting_buffer_typed(keyevent_t event);
 static bool waiting_buffer_has_anykey_pressed(void);
@@ -44,11 +54,17 @@ void action_tapping_process(keyrecord_t record)
         }
     } else {
         if (!waiting_buffer_enq(record)) {
-            // clear all in case of overflow.
-            debug("OVERFLOW: CLEAR ALL STATES\n");
-            clear_keyboard();
-            waiting_buffer_clear();
-            tapping_key = (keyrecord_t){};
+            // make room by settling the tap key and running the oldest events
+            debug("OVERFLOW: SETTLE TAPPING KEY\n");
+            waiting_buffer_overflows++;
+            waiting_buffer_settle();
+            if (!waiting_buffer_enq(record)) {
+                // clear all in case of overflow.
+                debug("OVERFLOW: CLEAR ALL STATES\n");
+                clear_keyboard();
+                waiting_buffer_clear();
+                tapping_key = (keyrecord_t){};
+            }
         }
     }
 
@@ -56,19 +72,22 @@ void action_tapping_process(keyrecord_t record)
     if (!IS_NOEVENT(record.event) && waiting_buffer_head != waiting_buffer_tail) {
         debug("---- action_exec: process waiting_buffer -----\n");
     }
-    for (; waiting_buffer_tail != waiting_buffer_head; waiting_buffer_tail = (waiting_buffer_tail + 1) % WAITING_BUFFER_SIZE) {
-        if (process_tapping(&waiting_buffer[waiting_buffer_tail])) {
-            debug("processed: waiting_buffer["); debug_dec(waiting_buffer_tail); debug("] = ");
-            debug_record(waiting_buffer[waiting_buffer_tail]); debug("\n\n");
-        } else {
-            break;
-        }
-    }
+    waiting_buffer_process();
     if (!IS_NOEVENT(record.event)) {
         debug("\n");
     }
 }
 
+uint8_t action_tapping_buffer_high_water(void)
+{
+    return waiting_buffer_high_water;
+}
+
+uint16_t action_tapping_buffer_overflows(void)
+{
+    return waiting_buffer_overflows;
+}
+
 
 /* Tapping
  *
@@ -296,18 +315,48 @@ bool waiting_buffer_enq(keyrecord_t record)
         return true;
     }
 
-    if ((waiting_buffer_head + 1) % WAITING_BUFFER_SIZE == waiting_buffer_tail) {
+    if (WAITING_BUFFER_NEXT(waiting_buffer_head) == waiting_buffer_tail) {
         debug("waiting_buffer_enq: Over flow.\n");
         return false;
     }
 
     waiting_buffer[waiting_buffer_head] = record;
-    waiting_buffer_head = (waiting_buffer_head + 1) % WAITING_BUFFER_SIZE;
+    waiting_buffer_head = WAITING_BUFFER_NEXT(waiting_buffer_head);
+    if (WAITING_BUFFER_COUNT() > waiting_buffer_high_water) {
+        waiting_buffer_high_water = WAITING_BUFFER_COUNT();
+    }
 
     debug("waiting_buffer_enq: "); debug_waiting_buffer();
     return true;
 }
 
+/* run buffered events in order until one has to wait for the tap key again */
+void waiting_buffer_process(void)
+{
+    for (; waiting_buffer_tail != waiting_buffer_head; waiting_buffer_tail = WAITING_BUFFER_NEXT(waiting_buffer_tail)) {
+        if (process_tapping(&waiting_buffer[waiting_buffer_tail])) {
+            debug("processed: waiting_buffer["); debug_dec(waiting_buffer_tail); debug("] = ");
+            debug_record(waiting_buffer[waiting_buffer_tail]); debug("\n\n");
+        } else {
+            break;
+        }
+    }
+}
+
+/* Settle an undecided tap key as held, as if TAPPING_TERM had passed,
+ * so the events buffered behind it can run in order.
+ */
+void waiting_buffer_settle(void)
+{
+    if (IS_TAPPING_PRESSED() && tapping_key.tap.count == 0) {
+        debug("Tapping: End. Buffer full. Not tap(0)\n");
+        process_record(&tapping_key);
+        tapping_key = (keyrecord_t){};
+        debug_tapping_key();
+    }
+    waiting_buffer_process();
+}
+
 void waiting_buffer_clear(void)
 {
     waiting_buffer_head = 0;
@@ -316,7 +365,7 @@ void waiting_buffer_clear(void)
 
 bool waiting_buffer_typed(keyevent_t event)
 {
-    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
+    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = WAITING_BUFFER_NEXT(i)) {
         if (KEYEQ(event.key, waiting_buffer[i].event.key) && event.pressed !=  waiting_buffer[i].event.pressed) {
             return true;
         }
@@ -327,7 +376,7 @@ bool waiting_buffer_typed(keyevent_t event)
 __attribute__((unused))
 bool waiting_buffer_has_anykey_pressed(void)
 {
-    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
+    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = WAITING_BUFFER_NEXT(i)) {
         if (waiting_buffer[i].event.pressed) return true;
     }
     return false;
@@ -341,7 +390,7 @@ void waiting_buffer_scan_tap(void)
     // invalid state: tapping_key released && tap.count == 0
     if (!tapping_key.event.pressed) return;
 
-    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
+    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = WAITING_BUFFER_NEXT(i)) {
         if (IS_TAPPING_KEY(waiting_buffer[i].event.key) &&
                 !waiting_buffer[i].event.pressed &&
                 WITHIN_TAPPING_TERM(waiting_buffer[i].event)) {
@@ -368,7 +417,7 @@ static void debug_tapping_key(void)
 static void debug_waiting_buffer(void)
 {
     debug("{ ");
-    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
+    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = WAITING_BUFFER_NEXT(i)) {
         debug("["); debug_dec(i); debug("]="); debug_record(waiting_buffer[i]); debug(" ");
     }
     debug("}\n");
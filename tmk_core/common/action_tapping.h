@@ -29,11 +29,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define TAPPING_TOGGLE  5
 #endif
 
+/* events held back while a tap key is undecided, power of two up to 128 */
+#ifndef WAITING_BUFFER_SIZE
 #define WAITING_BUFFER_SIZE 8
+#endif
 
 
 #ifndef NO_ACTION_TAPPING
 void action_tapping_process(keyrecord_t record);
+/* most events ever held in the waiting buffer, and times it ran full */
+uint8_t action_tapping_buffer_high_water(void);
+uint16_t action_tapping_buffer_overflows(void);
 #endif
 
 #endif
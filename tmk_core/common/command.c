@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "bootloader.h"
 #include "action_layer.h"
 #include "action_util.h"
+#include "action_tapping.h"
 #include "eeconfig.h"
 #include "sleep_led.h"
 #include "led.h"
@@ -54,6 +55,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
     #include "audio.h"
 #endif /* AUDIO_ENABLE */
 
+#ifdef SERIAL_LINK_ENABLE
+    #include "serial_link/system/serial_link.h"
+#endif
+
 
 static bool command_common(uint8_t code);
 static void command_common_help(void);
@@ -240,6 +245,16 @@ static void print_status(void)
     print_val_hex8(keyboard_nkro);
 #endif
     print_val_hex32(timer_read32());
+#ifdef DEBUG_MATRIX_SCAN_RATE
+    print_val_dec(keyboard_scan_rate());
+#endif
+#ifndef NO_ACTION_TAPPING
+    print_val_dec(action_tapping_buffer_high_water());
+    print_val_dec(action_tapping_buffer_overflows());
+#endif
+#ifdef SERIAL_LINK_ENABLE
+    serial_link_print_stats();
+#endif
 
 #ifdef PROTOCOL_PJRC
     print_val_hex8(UDCON);
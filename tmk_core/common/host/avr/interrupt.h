@@ -0,0 +1,9 @@
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+/* the simulator is single threaded and has no interrupts */
+#define cli()
+#define sei()
+#define ISR(vector, ...)    void vector(void)
+
+#endif
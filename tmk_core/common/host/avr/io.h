@@ -0,0 +1,34 @@
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+#include "sim.h"
+
+/*
+ * GPIO registers of the ATmega32U4 at their I/O space addresses, so the
+ * pin codes of config_common.h (PINx address in the upper nibble) work
+ * unchanged. Reading a PINx register samples the simulated switches.
+ */
+#define _SFR_IO8(addr)  (*sim_io_register(addr))
+#define _BV(bit)        (1 << (bit))
+
+#define PINB    _SFR_IO8(0x03)
+#define DDRB    _SFR_IO8(0x04)
+#define PORTB   _SFR_IO8(0x05)
+#define PINC    _SFR_IO8(0x06)
+#define DDRC    _SFR_IO8(0x07)
+#define PORTC   _SFR_IO8(0x08)
+#define PIND    _SFR_IO8(0x09)
+#define DDRD    _SFR_IO8(0x0A)
+#define PORTD   _SFR_IO8(0x0B)
+#define PINE    _SFR_IO8(0x0C)
+#define DDRE    _SFR_IO8(0x0D)
+#define PORTE   _SFR_IO8(0x0E)
+#define PINF    _SFR_IO8(0x0F)
+#define DDRF    _SFR_IO8(0x10)
+#define PORTF   _SFR_IO8(0x11)
+
+#define MCUCR   _SFR_IO8(0x35)
+#define JTD     7
+
+#endif
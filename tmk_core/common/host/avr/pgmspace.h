@@ -0,0 +1,23 @@
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Flash reads made so far, one per pgm_read_*, memcpy_P and strlen_P
+ * call. The simulator prints it per event. Weak so the host tests that
+ * build a single file get it without defining it.
+ */
+__attribute__ ((weak)) uint32_t sim_progmem_reads;
+
+/* flash and RAM share one address space on the host */
+#define PROGMEM
+#define PSTR(s)                 (s)
+#define pgm_read_byte(p)        (sim_progmem_reads++, *(const uint8_t *)(p))
+#define pgm_read_word(p)        (sim_progmem_reads++, *(const uint16_t *)(p))
+#define pgm_read_dword(p)       (sim_progmem_reads++, *(const uint32_t *)(p))
+#define memcpy_P(d, s, n)       (sim_progmem_reads++, memcpy((d), (s), (n)))
+#define strlen_P(s)             (sim_progmem_reads++, strlen(s))
+
+#endif
@@ -0,0 +1,91 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "eeprom.h"
+
+/* erased EEPROM reads 0xFF, so eeconfig starts out uninitialised */
+#define EEPROM_SIZE 1024
+
+static uint8_t buffer[EEPROM_SIZE];
+static bool erased = false;
+
+static uint8_t *eeprom_addr(const void *p)
+{
+    if (!erased) {
+        memset(buffer, 0xFF, EEPROM_SIZE);
+        erased = true;
+    }
+    return &buffer[(uintptr_t)p % EEPROM_SIZE];
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr)
+{
+    return *eeprom_addr(addr);
+}
+
+uint16_t eeprom_read_word(const uint16_t *addr)
+{
+    uint16_t value;
+    eeprom_read_block(&value, addr, sizeof(value));
+    return value;
+}
+
+uint32_t eeprom_read_dword(const uint32_t *addr)
+{
+    uint32_t value;
+    eeprom_read_block(&value, addr, sizeof(value));
+    return value;
+}
+
+void eeprom_read_block(void *buf, const void *addr, uint32_t len)
+{
+    uint8_t *dst = buf;
+    const uint8_t *src = addr;
+    while (len--) {
+        *dst++ = *eeprom_addr(src++);
+    }
+}
+
+void eeprom_write_byte(uint8_t *addr, uint8_t value)
+{
+    *eeprom_addr(addr) = value;
+}
+
+void eeprom_write_word(uint16_t *addr, uint16_t value)
+{
+    eeprom_write_block(&value, addr, sizeof(value));
+}
+
+void eeprom_write_dword(uint32_t *addr, uint32_t value)
+{
+    eeprom_write_block(&value, addr, sizeof(value));
+}
+
+void eeprom_write_block(const void *buf, void *addr, uint32_t len)
+{
+    const uint8_t *src = buf;
+    uint8_t *dst = addr;
+    while (len--) {
+        *eeprom_addr(dst++) = *src++;
+    }
+}
+
+void eeprom_update_byte(uint8_t *addr, uint8_t value)
+{
+    eeprom_write_byte(addr, value);
+}
+
+void eeprom_update_word(uint16_t *addr, uint16_t value)
+{
+    eeprom_write_word(addr, value);
+}
+
+void eeprom_update_dword(uint32_t *addr, uint32_t value)
+{
+    eeprom_write_dword(addr, value);
+}
+
+void eeprom_update_block(const void *buf, void *addr, uint32_t len)
+{
+    eeprom_write_block(buf, addr, len);
+}
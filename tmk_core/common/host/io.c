@@ -0,0 +1,70 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include "matrix.h"
+#include "sim.h"
+
+/*
+ * Switch matrix wired to MATRIX_ROW_PINS/MATRIX_COL_PINS.
+ *
+ * An input pin reads its pull-up (the PORTx bit) unless a closed switch
+ * connects it to a pin that drives low. The diode only lets the side
+ * quantum/matrix.c selects (rows for COL2ROW, columns for ROW2COL) pull
+ * the other side down.
+ */
+
+#define IO_SIZE 0x40
+
+static uint8_t io[IO_SIZE];
+static matrix_row_t keys[MATRIX_ROWS];
+
+static const uint8_t row_pins[MATRIX_ROWS] = MATRIX_ROW_PINS;
+static const uint8_t col_pins[MATRIX_COLS] = MATRIX_COL_PINS;
+
+#define PIN_ADDR(pin)   ((pin) >> 4)
+#define DDR_ADDR(pin)   (PIN_ADDR(pin) + 1)
+#define PORT_ADDR(pin)  (PIN_ADDR(pin) + 2)
+#define PIN_MASK(pin)   _BV((pin) & 0xF)
+
+static bool is_low_output(uint8_t pin)
+{
+    return (io[DDR_ADDR(pin)] & PIN_MASK(pin)) && !(io[PORT_ADDR(pin)] & PIN_MASK(pin));
+}
+
+static void sample_pins(void)
+{
+    for (uint8_t addr = 0x03; addr <= 0x0F; addr += 3) {
+        io[addr] = io[addr + 2];
+    }
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (!(keys[row] & ((matrix_row_t)1 << col))) continue;
+#if DIODE_DIRECTION == COL2ROW
+            uint8_t drive = row_pins[row], sense = col_pins[col];
+#else
+            uint8_t drive = col_pins[col], sense = row_pins[row];
+#endif
+            if (is_low_output(drive) && !(io[DDR_ADDR(sense)] & PIN_MASK(sense))) {
+                io[PIN_ADDR(sense)] &= ~PIN_MASK(sense);
+            }
+        }
+    }
+}
+
+volatile uint8_t *sim_io_register(uint8_t addr)
+{
+    if (addr >= 0x03 && addr <= 0x0F && addr % 3 == 0) {
+        sample_pins();
+    }
+    return &io[addr % IO_SIZE];
+}
+
+void sim_key_set(uint8_t row, uint8_t col, bool pressed)
+{
+    if (row >= MATRIX_ROWS || col >= MATRIX_COLS) return;
+    if (pressed) {
+        keys[row] |= ((matrix_row_t)1 << col);
+    } else {
+        keys[row] &= ~((matrix_row_t)1 << col);
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Host platform used by `make host-sim`.
+ *
+ * Time does not pass on its own: the clock only moves when the firmware
+ * waits (wait_us/wait_ms) or when the simulator advances it between scans,
+ * so a replayed script always gives the same reports at the same times.
+ */
+
+/* simulated clock */
+uint32_t sim_clock_us(void);
+void sim_clock_advance_us(uint32_t us);
+
+/* AVR I/O space, _SFR_IO8(addr) */
+volatile uint8_t *sim_io_register(uint8_t addr);
+
+/* switch state seen through MATRIX_ROW_PINS/MATRIX_COL_PINS */
+void sim_key_set(uint8_t row, uint8_t col, bool pressed);
+
+#endif
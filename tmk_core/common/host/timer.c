@@ -0,0 +1,51 @@
+#include <stdint.h>
+#include "timer.h"
+#include "sim.h"
+
+/* milliseconds since timer_clear(), derived from the simulated clock */
+volatile uint32_t timer_count = 0;
+
+static uint32_t clock_us = 0;
+static uint32_t timer_base_us = 0;
+
+uint32_t sim_clock_us(void)
+{
+    return clock_us;
+}
+
+void sim_clock_advance_us(uint32_t us)
+{
+    clock_us += us;
+    timer_count = (clock_us - timer_base_us) / 1000;
+}
+
+void timer_init(void)
+{
+    timer_clear();
+}
+
+void timer_clear(void)
+{
+    timer_base_us = clock_us;
+    timer_count = 0;
+}
+
+uint16_t timer_read(void)
+{
+    return (uint16_t)timer_count;
+}
+
+uint32_t timer_read32(void)
+{
+    return timer_count;
+}
+
+uint16_t timer_elapsed(uint16_t last)
+{
+    return TIMER_DIFF_16(timer_read(), last);
+}
+
+uint32_t timer_elapsed32(uint32_t last)
+{
+    return TIMER_DIFF_32(timer_read32(), last);
+}
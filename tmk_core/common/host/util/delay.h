@@ -0,0 +1,10 @@
+#ifndef HOST_UTIL_DELAY_H
+#define HOST_UTIL_DELAY_H
+
+/* busy waits only move the simulated clock */
+#include "sim.h"
+
+#define _delay_us(us)   sim_clock_advance_us((uint32_t)(us))
+#define _delay_ms(ms)   sim_clock_advance_us((uint32_t)(ms) * 1000UL)
+
+#endif
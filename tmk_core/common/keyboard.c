@@ -74,6 +74,60 @@ static bool has_ghost_in_row(uint8_t row)
 }
 #endif
 
+#ifdef BATCH_KEY_EVENTS
+/* Hand every change found in one scan to action_exec in a single pass.
+ * Releases go first so a roll frees its report slot before the next key
+ * lands, then presses; both in row/col order. All events share one timestamp.
+ */
+static void keyboard_exec_batch(const matrix_row_t matrix_change[], matrix_row_t matrix_prev[])
+{
+    uint16_t time = timer_read() | 1; /* time should not be 0 */
+
+    for (uint8_t pressed = 0; pressed < 2; pressed++) {
+        for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+            matrix_row_t matrix_row = matrix_get_row(r);
+            matrix_row_t events = matrix_change[r] & (pressed ? matrix_row : ~matrix_row);
+            if (!events) continue;
+            for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+                if (events & ((matrix_row_t)1<<c)) {
+                    action_exec((keyevent_t){
+                        .key = (keypos_t){ .row = r, .col = c },
+                        .pressed = pressed,
+                        .time = time
+                    });
+                    // record a processed key
+                    matrix_prev[r] ^= ((matrix_row_t)1<<c);
+                }
+            }
+        }
+    }
+}
+#endif
+
+#ifdef DEBUG_MATRIX_SCAN_RATE
+static uint32_t scan_timer = 0;
+static uint32_t scan_count = 0;
+static uint16_t scan_rate = 0;
+
+/* count scans and update the rate about once a second */
+static void matrix_scan_perf_task(void)
+{
+    scan_count++;
+    uint32_t elapsed = timer_elapsed32(scan_timer);
+    if (elapsed >= 1000) {
+        uint32_t rate = scan_count * 1000 / elapsed;
+        scan_rate = rate > UINT16_MAX ? UINT16_MAX : rate;
+        scan_timer = timer_read32();
+        scan_count = 0;
+    }
+}
+
+uint16_t keyboard_scan_rate(void)
+{
+    return scan_rate;
+}
+#endif
+
 __attribute__ ((weak))
 void matrix_setup(void) {
 }
@@ -123,8 +177,15 @@ void keyboard_task(void)
     static uint8_t led_status = 0;
     matrix_row_t matrix_row = 0;
     matrix_row_t matrix_change = 0;
+#ifdef BATCH_KEY_EVENTS
+    matrix_row_t matrix_batch[MATRIX_ROWS] = { 0 };
+    bool has_batch = false;
+#endif
 
     matrix_scan();
+#ifdef DEBUG_MATRIX_SCAN_RATE
+    matrix_scan_perf_task();
+#endif
     for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
         matrix_row = matrix_get_row(r);
         matrix_change = matrix_row ^ matrix_prev[r];
@@ -144,6 +205,12 @@ void keyboard_task(void)
             matrix_ghost[r] = matrix_row;
 #endif
             if (debug_matrix) matrix_print();
+#ifdef BATCH_KEY_EVENTS
+            // collect the whole scan, processed below
+            matrix_batch[r] = matrix_change;
+            has_batch = true;
+            continue;
+#endif
             for (uint8_t c = 0; c < MATRIX_COLS; c++) {
                 if (matrix_change & ((matrix_row_t)1<<c)) {
                     action_exec((keyevent_t){
@@ -159,6 +226,12 @@ void keyboard_task(void)
             }
         }
     }
+#ifdef BATCH_KEY_EVENTS
+    if (has_batch) {
+        keyboard_exec_batch(matrix_batch, matrix_prev);
+        goto MATRIX_LOOP_END;
+    }
+#endif
     // call with pseudo tick event when no real key event.
     action_exec(TICK);
 
@@ -185,6 +258,10 @@ MATRIX_LOOP_END:
 	serial_link_update();
 #endif
 
+#ifdef RGBLIGHT_ENABLE
+    rgblight_task();
+#endif
+
 #ifdef VISUALIZER_ENABLE
     visualizer_update(default_layer_state, layer_state, host_keyboard_leds());
 #endif
@@ -66,6 +66,10 @@ void keyboard_init(void);
 void keyboard_task(void);
 /* it runs when host LED status is updated */
 void keyboard_set_leds(uint8_t leds);
+#ifdef DEBUG_MATRIX_SCAN_RATE
+/* matrix scans per second, updated once a second */
+uint16_t keyboard_scan_rate(void);
+#endif
 
 #ifdef __cplusplus
 }
@@ -42,6 +42,10 @@ void print_set_sendchar(int8_t (*sendchar_func)(uint8_t))
 
 // don't need anything extra
 
+#elif defined(PROTOCOL_HOST_SIM) /* __AVR__ */
+
+// don't need anything extra
+
 #elif defined(__arm__) /* __AVR__ */
 
 // TODO
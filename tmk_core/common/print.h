@@ -55,6 +55,16 @@ void print_set_sendchar(int8_t (*print_sendchar_func)(uint8_t));
 #define println(s)  printf(s "\r\n")
 #define xprintf  printf
 
+#elif defined(PROTOCOL_HOST_SIM) /* __AVR__ */
+
+#include <stdio.h>
+
+/* console goes to stderr, stdout carries the simulated reports */
+#define print(s)    fputs(s, stderr)
+#define println(s)  fputs(s "\r\n", stderr)
+#define xprintf(...) fprintf(stderr, __VA_ARGS__)
+#define print_set_sendchar(func)
+
 #elif defined(__arm__) /* __AVR__ */
 
 #include "mbed/xprintf.h"
@@ -75,7 +85,7 @@ void print_set_sendchar(int8_t (*print_sendchar_func)(uint8_t));
 #define print_hex4(i)               xprintf("%X", i)
 #define print_hex8(i)               xprintf("%02X", i)
 #define print_hex16(i)              xprintf("%04X", i)
-#define print_hex32(i)              xprintf("%08lX", i)
+#define print_hex32(i)              xprintf("%08lX", (unsigned long)(i))
 /* binary */
 #define print_bin4(i)               xprintf("%04b", i)
 #define print_bin8(i)               xprintf("%08b", i)
@@ -89,7 +99,7 @@ void print_set_sendchar(int8_t (*print_sendchar_func)(uint8_t));
 #define print_val_decs(v)           xprintf(#v ": %d\n", v)
 #define print_val_hex8(v)           xprintf(#v ": %X\n", v)
 #define print_val_hex16(v)          xprintf(#v ": %02X\n", v)
-#define print_val_hex32(v)          xprintf(#v ": %04lX\n", v)
+#define print_val_hex32(v)          xprintf(#v ": %04lX\n", (unsigned long)(v))
 #define print_val_bin8(v)           xprintf(#v ": %08b\n", v)
 #define print_val_bin16(v)          xprintf(#v ": %016b\n", v)
 #define print_val_bin32(v)          xprintf(#v ": %032lb\n", v)
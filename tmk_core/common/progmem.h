@@ -1,7 +1,7 @@
 #ifndef PROGMEM_H
 #define PROGMEM_H 1
 
-#if defined(__AVR__)
+#if defined(__AVR__) || defined(PROTOCOL_HOST_SIM)
 #   include <avr/pgmspace.h>
 #elif defined(__arm__)
 #   define PROGMEM
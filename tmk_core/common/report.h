@@ -89,6 +89,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #   define KEYBOARD_REPORT_SIZE NKRO_EPSIZE
 #   define KEYBOARD_REPORT_KEYS (NKRO_EPSIZE - 2)
 #   define KEYBOARD_REPORT_BITS (NKRO_EPSIZE - 1)
+#elif defined(PROTOCOL_HOST_SIM) && defined(NKRO_ENABLE)
+/* same size as the LUFA NKRO endpoint */
+#   define KEYBOARD_REPORT_SIZE 16
+#   define KEYBOARD_REPORT_KEYS (16 - 2)
+#   define KEYBOARD_REPORT_BITS (16 - 1)
 
 #else
 #   define KEYBOARD_REPORT_SIZE 8
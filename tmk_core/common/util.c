@@ -99,3 +99,44 @@ uint32_t bitrev32(uint32_t bits)
     bits = (uint32_t)bitrev16(bits & 0x0000ffff)<<16 | bitrev16((bits & 0xffff0000)>>16);
     return bits;
 }
+
+
+// bit matrix transpose - bit x of bits[y] is swapped with bit y of bits[x]
+// by swapping ever smaller off-diagonal blocks
+void bittrans(uint8_t bits[8])
+{
+    uint8_t j, k, m, t;
+    for (j = 4, m = 0x0f; j; j >>= 1, m ^= (uint8_t)(m << j)) {
+        for (k = 0; k < 8; k = (k + j + 1) & ~j) {
+            t = ((bits[k] >> j) ^ bits[k + j]) & m;
+            bits[k + j] ^= t;
+            bits[k] ^= t << j;
+        }
+    }
+}
+
+void bittrans16(uint16_t bits[16])
+{
+    uint8_t j, k;
+    uint16_t m, t;
+    for (j = 8, m = 0x00ff; j; j >>= 1, m ^= (uint16_t)(m << j)) {
+        for (k = 0; k < 16; k = (k + j + 1) & ~j) {
+            t = ((bits[k] >> j) ^ bits[k + j]) & m;
+            bits[k + j] ^= t;
+            bits[k] ^= t << j;
+        }
+    }
+}
+
+void bittrans32(uint32_t bits[32])
+{
+    uint8_t j, k;
+    uint32_t m, t;
+    for (j = 16, m = 0x0000ffff; j; j >>= 1, m ^= (uint32_t)(m << j)) {
+        for (k = 0; k < 32; k = (k + j + 1) & ~j) {
+            t = ((bits[k] >> j) ^ bits[k + j]) & m;
+            bits[k + j] ^= t;
+            bits[k] ^= t << j;
+        }
+    }
+}
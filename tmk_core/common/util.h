@@ -40,4 +40,8 @@ uint8_t  bitrev(uint8_t bits);
 uint16_t bitrev16(uint16_t bits);
 uint32_t bitrev32(uint32_t bits);
 
+void bittrans(uint8_t bits[8]);
+void bittrans16(uint16_t bits[16]);
+void bittrans32(uint32_t bits[32]);
+
 #endif
@@ -5,7 +5,7 @@
 extern "C" {
 #endif
 
-#if defined(__AVR__)
+#if defined(__AVR__) || defined(PROTOCOL_HOST_SIM)
 #   include <util/delay.h>
 #   define wait_ms(ms)  _delay_ms(ms)
 #   define wait_us(us)  _delay_us(us)
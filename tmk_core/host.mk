@@ -0,0 +1,57 @@
+# Hey Emacs, this is a -*- makefile -*-
+##############################################################################
+# Compiler settings
+#
+CC = gcc
+OBJCOPY = objcopy
+OBJDUMP = objdump
+SIZE = size
+AR = ar rcs
+NM = nm
+
+ifdef CUSTOM_MATRIX
+    $(error host-sim drives the pins of quantum/matrix.c, keyboards with CUSTOM_MATRIX are not supported)
+endif
+
+COMPILEFLAGS += -funsigned-char
+COMPILEFLAGS += -funsigned-bitfields
+COMPILEFLAGS += -ffunction-sections
+COMPILEFLAGS += -fdata-sections
+
+CFLAGS += $(COMPILEFLAGS)
+CFLAGS += -fno-strict-aliasing
+
+CPPFLAGS += $(COMPILEFLAGS)
+CPPFLAGS += -fno-exceptions
+
+LDFLAGS += -Wl,--gc-sections
+
+ifdef F_CPU
+    OPT_DEFS += -DF_CPU=$(F_CPU)UL
+endif
+
+MCUFLAGS =
+
+# The simulator repeats the layer lookups made before records carried
+# their resolved action, to count the flash reads they cost
+ifneq (,$(findstring -DHOST_SIM_RESOLVE_TWICE,$(EXTRAFLAGS)))
+    LDFLAGS += -Wl,--wrap=layer_switch_resolve
+endif
+
+# avr/io.h, avr/pgmspace.h and util/delay.h stand-ins
+EXTRAINCDIRS += $(TMK_PATH)/$(COMMON_DIR)/host
+
+# Build the simulator, and run it when a script is given:
+#   make KEYBOARD=planck host-sim SCRIPT=tmk_core/protocol/host_sim/examples/hello.txt
+# With EXPECT the reports are compared against a recorded run instead.
+host-sim: $(BUILD_DIR)/$(TARGET).elf
+	@$(SILENT) || printf "Simulator: $(BUILD_DIR)/$(TARGET).elf\n"
+ifdef SCRIPT
+ifdef EXPECT
+	$(BUILD_DIR)/$(TARGET).elf $(SCRIPT) 2>/dev/null | diff -u $(EXPECT) -
+else
+	$(BUILD_DIR)/$(TARGET).elf $(SCRIPT)
+endif
+endif
+
+.PHONY: host-sim
@@ -0,0 +1,10 @@
+PROTOCOL_DIR = protocol
+HOST_SIM_DIR = $(PROTOCOL_DIR)/host_sim
+
+
+SRC += $(HOST_SIM_DIR)/main.c
+
+OPT_DEFS += -DPROTOCOL_HOST_SIM
+
+VPATH += $(TMK_PATH)/$(PROTOCOL_DIR)
+VPATH += $(TMK_PATH)/$(HOST_SIM_DIR)
@@ -0,0 +1,342 @@
+/*
+ * Host simulator: replays a key event script through the real matrix scan,
+ * debounce, action and quantum code and prints every HID report the
+ * keyboard would send, stamped with the simulated time.
+ *
+ * Script format, one event per line, times in milliseconds and in order:
+ *
+ *     # comment
+ *     0     down 0 1
+ *     35.5  up   0 1
+ *
+ * Output, one line per report:
+ *
+ *     12.300 keyboard 00 00 04 00 00 00 00 00
+ *     40.100 mouse 01 00 00 00 00
+ *     52.000 system 0082
+ *     60.000 consumer 00E9
+ *
+ * followed by a summary of report counts and event to report latency.
+ * Latency is given in time to the first report after an event, and in
+ * scans to the last report of the burst that report starts, a burst being
+ * reports sent on consecutive scans. A chord that reaches the host one key
+ * per scan shows up in the second. Flash reads (pgm_read_* and friends)
+ * are counted from the first scan on and given per event.
+ * Host CPU time spent in keyboard_task() goes to stderr, since it differs
+ * between runs.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "keyboard.h"
+#include "host.h"
+#include "host_driver.h"
+#include "report.h"
+#include "action.h"
+#include "action_layer.h"
+#include "keymap.h"
+#include "sim.h"
+#include <avr/pgmspace.h>
+
+
+/* simulated time spent per main loop iteration on top of the waits in the scan */
+#ifndef HOST_SIM_LOOP_US
+#define HOST_SIM_LOOP_US 100
+#endif
+
+/* keep running after the last event so taps and timeouts can resolve */
+#ifndef HOST_SIM_SETTLE_MS
+#define HOST_SIM_SETTLE_MS 1000
+#endif
+
+
+/* report protocol, the host never switches to boot protocol */
+uint8_t keyboard_idle = 0;
+uint8_t keyboard_protocol = 1;
+
+typedef struct {
+    uint32_t time_us;
+    uint32_t scan;  /* first keyboard_task() call that sees the event */
+    uint8_t row;
+    uint8_t col;
+    bool pressed;
+} sim_event_t;
+
+static sim_event_t *events;
+static size_t event_count;
+static size_t event_next;
+
+static struct {
+    uint32_t keyboard;
+    uint32_t mouse;
+    uint32_t system;
+    uint32_t consumer;
+} report_count;
+
+/* events not yet followed by a report */
+static size_t latency_from;
+static uint64_t latency_sum_us;
+static uint32_t latency_max_us;
+static uint32_t latency_samples;
+
+static uint32_t scans;
+
+/* events answered by the reports of the current burst */
+static size_t burst_from;
+static size_t burst_to;
+static uint32_t burst_last_scan;
+static bool scan_reported;
+static uint64_t burst_sum_scans;
+static uint32_t burst_max_scans;
+static uint32_t burst_samples;
+
+
+#ifdef HOST_SIM_RESOLVE_TWICE
+/*
+ * Built with -Wl,--wrap=layer_switch_resolve, see host.mk. Before the
+ * record carried its resolved keycode and action, process_record_quantum()
+ * walked the layers and read the keymap on its own and process_record()
+ * did it again through store_or_get_action(), each time a record was
+ * processed. This repeats the lookups the record now saves, so the flash
+ * reads of both schemes can be compared.
+ */
+void __real_layer_switch_resolve(keyrecord_t *record);
+
+void __wrap_layer_switch_resolve(keyrecord_t *record)
+{
+    keypos_t key = record->event.key;
+#if !defined(NO_ACTION_LAYER) && defined(PREVENT_STUCK_MODIFIERS)
+    uint8_t layer = record->event.pressed ? layer_switch_get_layer(key) : read_source_layers_cache(key);
+#else
+    uint8_t layer = layer_switch_get_layer(key);
+#endif
+    keymap_key_to_keycode(layer, key);
+    if (record->resolved) {
+        store_or_get_action(record->event.pressed, key);
+    }
+    __real_layer_switch_resolve(record);
+}
+#endif
+
+
+static void print_time(void)
+{
+    uint32_t now = sim_clock_us();
+    printf("%lu.%03lu ", (unsigned long)(now / 1000), (unsigned long)(now % 1000));
+}
+
+static void record_latency(void)
+{
+    uint32_t now = sim_clock_us();
+    for (; latency_from < event_next; latency_from++) {
+        uint32_t latency = now - events[latency_from].time_us;
+        latency_sum_us += latency;
+        if (latency > latency_max_us) latency_max_us = latency;
+        latency_samples++;
+    }
+    burst_to = event_next;
+    scan_reported = true;
+}
+
+/* Called after every scan, a scan without reports ends the burst */
+static void record_burst(void)
+{
+    if (scan_reported) {
+        burst_last_scan = scans;
+        scan_reported = false;
+        return;
+    }
+    for (; burst_from < burst_to; burst_from++) {
+        uint32_t latency = burst_last_scan - events[burst_from].scan + 1;
+        burst_sum_scans += latency;
+        if (latency > burst_max_scans) burst_max_scans = latency;
+        burst_samples++;
+    }
+}
+
+
+/* host driver */
+static uint8_t keyboard_leds(void);
+static void send_keyboard(report_keyboard_t *report);
+static void send_mouse(report_mouse_t *report);
+static void send_system(uint16_t data);
+static void send_consumer(uint16_t data);
+
+static host_driver_t driver = {
+    keyboard_leds,
+    send_keyboard,
+    send_mouse,
+    send_system,
+    send_consumer
+};
+
+static uint8_t keyboard_leds(void)
+{
+    return 0;
+}
+
+static void send_keyboard(report_keyboard_t *report)
+{
+    uint8_t size = KEYBOARD_REPORT_SIZE;
+#ifdef NKRO_ENABLE
+    if (!(keyboard_protocol && keyboard_nkro)) size = 8;
+#endif
+    record_latency();
+    report_count.keyboard++;
+    print_time();
+    printf("keyboard");
+    for (uint8_t i = 0; i < size; i++) {
+        printf(" %02X", report->raw[i]);
+    }
+    printf("\n");
+}
+
+static void send_mouse(report_mouse_t *report)
+{
+    record_latency();
+    report_count.mouse++;
+    print_time();
+    printf("mouse %02X %02X %02X %02X %02X\n", report->buttons,
+           (uint8_t)report->x, (uint8_t)report->y, (uint8_t)report->v, (uint8_t)report->h);
+}
+
+static void send_system(uint16_t data)
+{
+    record_latency();
+    report_count.system++;
+    print_time();
+    printf("system %04X\n", data);
+}
+
+static void send_consumer(uint16_t data)
+{
+    record_latency();
+    report_count.consumer++;
+    print_time();
+    printf("consumer %04X\n", data);
+}
+
+
+static bool load_script(FILE *script, const char *name)
+{
+    char line[128];
+    unsigned lineno = 0;
+    size_t capacity = 0;
+
+    while (fgets(line, sizeof(line), script)) {
+        double time_ms;
+        char action[8];
+        unsigned row, col;
+
+        lineno++;
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') continue;
+
+        if (sscanf(p, "%lf %7s %u %u", &time_ms, action, &row, &col) != 4 ||
+            (strcmp(action, "down") && strcmp(action, "up")) || time_ms < 0) {
+            fprintf(stderr, "%s:%u: expected '<time_ms> down|up <row> <col>'\n", name, lineno);
+            return false;
+        }
+        if (row >= MATRIX_ROWS || col >= MATRIX_COLS) {
+            fprintf(stderr, "%s:%u: key %u,%u is outside the %ux%u matrix\n",
+                    name, lineno, row, col, MATRIX_ROWS, MATRIX_COLS);
+            return false;
+        }
+
+        uint32_t time_us = (uint32_t)(time_ms * 1000 + 0.5);
+        if (event_count && time_us < events[event_count - 1].time_us) {
+            fprintf(stderr, "%s:%u: events must be in time order\n", name, lineno);
+            return false;
+        }
+
+        if (event_count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            events = realloc(events, capacity * sizeof(sim_event_t));
+            if (!events) {
+                perror("realloc");
+                return false;
+            }
+        }
+        events[event_count++] = (sim_event_t){
+            .time_us = time_us, .row = row, .col = col, .pressed = (action[0] == 'd')
+        };
+    }
+    return true;
+}
+
+static uint64_t cpu_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+int main(int argc, char *argv[])
+{
+    FILE *script = stdin;
+    const char *name = "<stdin>";
+
+    if (argc > 2) {
+        fprintf(stderr, "usage: %s [script]\n", argv[0]);
+        return 2;
+    }
+    if (argc == 2 && strcmp(argv[1], "-")) {
+        name = argv[1];
+        script = fopen(name, "r");
+        if (!script) {
+            perror(name);
+            return 1;
+        }
+    }
+    if (!load_script(script, name)) return 1;
+    if (script != stdin) fclose(script);
+
+    keyboard_setup();
+    keyboard_init();
+    host_set_driver(&driver);
+
+    uint32_t end_us = (event_count ? events[event_count - 1].time_us : 0) + HOST_SIM_SETTLE_MS * 1000UL;
+    uint64_t cpu_sum = 0, cpu_max = 0;
+    sim_progmem_reads = 0;
+
+    while (sim_clock_us() < end_us) {
+        for (; event_next < event_count && events[event_next].time_us <= sim_clock_us(); event_next++) {
+            sim_key_set(events[event_next].row, events[event_next].col, events[event_next].pressed);
+            events[event_next].scan = scans;
+        }
+
+        uint64_t start = cpu_time_ns();
+        keyboard_task();
+        uint64_t cost = cpu_time_ns() - start;
+        cpu_sum += cost;
+        if (cost > cpu_max) cpu_max = cost;
+        record_burst();
+        scans++;
+
+        sim_clock_advance_us(HOST_SIM_LOOP_US);
+    }
+
+    printf("# events %lu scans %lu\n", (unsigned long)event_count, (unsigned long)scans);
+    printf("# reports keyboard %lu mouse %lu system %lu consumer %lu\n",
+           (unsigned long)report_count.keyboard, (unsigned long)report_count.mouse,
+           (unsigned long)report_count.system, (unsigned long)report_count.consumer);
+    printf("# latency_us avg %lu max %lu (event to next report, %lu events)\n",
+           (unsigned long)(latency_samples ? latency_sum_us / latency_samples : 0),
+           (unsigned long)latency_max_us, (unsigned long)latency_samples);
+    record_burst();
+    printf("# latency_scans avg %lu max %lu (event to the last report of its burst, %lu events)\n",
+           (unsigned long)(burst_samples ? burst_sum_scans / burst_samples : 0),
+           (unsigned long)burst_max_scans, (unsigned long)burst_samples);
+    printf("# progmem_reads %lu (%lu.%02lu per event)\n", (unsigned long)sim_progmem_reads,
+           (unsigned long)(event_count ? sim_progmem_reads / event_count : 0),
+           (unsigned long)(event_count ? sim_progmem_reads * 100 / event_count % 100 : 0));
+    fprintf(stderr, "# keyboard_task cpu_ns avg %lu max %lu\n",
+            (unsigned long)(scans ? cpu_sum / scans : 0), (unsigned long)cpu_max);
+
+    free(events);
+    return 0;
+}